@@ -0,0 +1,31 @@
+// PlayStation 1 Animation Table
+// Model: coin
+// Actions: 1
+
+#ifndef COIN_ACTIONS_H
+#define COIN_ACTIONS_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+#include "coin-spin.h"
+
+#ifndef ANIMACTION_DEFINED
+#define ANIMACTION_DEFINED
+typedef struct {
+    const char *name;     // Action name
+    int frame_count;      // Number of baked frames
+    int vertex_count;     // Vertices per frame
+    SVECTOR *frames;      // frame_count * vertex_count vertices
+    int fps;              // Playback rate the action was baked at
+} AnimAction;
+#endif
+
+#define COIN_ACTIONS_COUNT 1
+#define COIN_ACTION_SPIN 0
+
+AnimAction coin_actions[COIN_ACTIONS_COUNT] = {
+    { "spin", SPIN_FRAMES_COUNT, SPIN_VERTICES_COUNT, &spin_anim[0][0], 60 },
+};
+
+#endif
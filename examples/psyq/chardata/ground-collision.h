@@ -0,0 +1,161 @@
+// PlayStation 1 Collision Mesh
+// Model: ground
+// Triangles: 50
+
+#ifndef GROUND_COLLISION_H
+#define GROUND_COLLISION_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+#define GROUND_COLLISION_VERTICES_COUNT 36
+#define GROUND_COLLISION_TRI_COUNT 50
+#define GROUND_COLLISION_CELL_SHIFT 14  // Suggested hash cell size (1 << shift)
+
+SVECTOR ground_collision_vertices[GROUND_COLLISION_VERTICES_COUNT] = {
+    { 9216, 0, 9216 },
+    { 15360, 0, 9216 },
+    { 15360, 0, 15360 },
+    { 9216, 0, 15360 },
+    { -15360, 0, 9216 },
+    { -9216, 0, 9216 },
+    { -9216, 0, 15360 },
+    { -15360, 0, 15360 },
+    { -3072, 0, 9216 },
+    { -3072, 0, 15360 },
+    { 3072, 0, 9216 },
+    { 3072, 0, 15360 },
+    { 3072, 0, -15360 },
+    { 9216, 0, -15360 },
+    { 9216, 0, -9216 },
+    { 3072, 0, -9216 },
+    { 9216, 0, -3072 },
+    { 3072, 0, -3072 },
+    { 9216, 0, 3072 },
+    { 3072, 0, 3072 },
+    { -3072, 0, -15360 },
+    { -3072, 0, -9216 },
+    { -3072, 0, -3072 },
+    { -3072, 0, 3072 },
+    { -9216, 0, -15360 },
+    { -9216, 0, -9216 },
+    { -9216, 0, -3072 },
+    { -9216, 0, 3072 },
+    { -15360, 0, -15360 },
+    { -15360, 0, -9216 },
+    { -15360, 0, -3072 },
+    { -15360, 0, 3072 },
+    { 15360, 0, -15360 },
+    { 15360, 0, -9216 },
+    { 15360, 0, -3072 },
+    { 15360, 0, 3072 },
+};
+
+unsigned short ground_collision_tris[GROUND_COLLISION_TRI_COUNT][3] = {
+    { 0, 1, 2 },
+    { 0, 2, 3 },
+    { 4, 5, 6 },
+    { 4, 6, 7 },
+    { 5, 8, 9 },
+    { 5, 9, 6 },
+    { 8, 10, 11 },
+    { 8, 11, 9 },
+    { 10, 0, 3 },
+    { 10, 3, 11 },
+    { 12, 13, 14 },
+    { 12, 14, 15 },
+    { 15, 14, 16 },
+    { 15, 16, 17 },
+    { 17, 16, 18 },
+    { 17, 18, 19 },
+    { 19, 18, 0 },
+    { 19, 0, 10 },
+    { 20, 12, 15 },
+    { 20, 15, 21 },
+    { 21, 15, 17 },
+    { 21, 17, 22 },
+    { 22, 17, 19 },
+    { 22, 19, 23 },
+    { 23, 19, 10 },
+    { 23, 10, 8 },
+    { 24, 20, 21 },
+    { 24, 21, 25 },
+    { 25, 21, 22 },
+    { 25, 22, 26 },
+    { 26, 22, 23 },
+    { 26, 23, 27 },
+    { 27, 23, 8 },
+    { 27, 8, 5 },
+    { 28, 24, 25 },
+    { 28, 25, 29 },
+    { 29, 25, 26 },
+    { 29, 26, 30 },
+    { 30, 26, 27 },
+    { 30, 27, 31 },
+    { 31, 27, 5 },
+    { 31, 5, 4 },
+    { 13, 32, 33 },
+    { 13, 33, 14 },
+    { 14, 33, 34 },
+    { 14, 34, 16 },
+    { 16, 34, 35 },
+    { 16, 35, 18 },
+    { 18, 35, 1 },
+    { 18, 1, 0 },
+};
+
+// Face normals (ONE = 4096)
+SVECTOR ground_collision_normals[GROUND_COLLISION_TRI_COUNT] = {
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+    { 0, -4096, 0 },
+};
+
+#endif
@@ -0,0 +1,38 @@
+// PlayStation 1 Scene Layout
+// Scene: props
+// Instances: 2
+
+#ifndef PROPS_SCENE_H
+#define PROPS_SCENE_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+#ifndef SCENEINSTANCE_DEFINED
+#define SCENEINSTANCE_DEFINED
+typedef struct {
+    int model;              // Index into the scene's model name table
+    long x, y, z;           // Position (scaled by PS1_SCALE)
+    short rx, ry, rz;       // Rotation (4096 = 360 degrees)
+    long sx, sy, sz;        // Scale (4096 = 1.0)
+    int slot;               // Texture slot
+    u_long visible_meshes;  // Sub-mesh visibility mask
+} SceneInstance;
+#endif
+
+#define PROPS_SCENE_MODEL_COUNT 2
+#define PROPS_SCENE_INSTANCE_COUNT 2
+#define PROPS_SCENE_MODEL_COIN 0
+#define PROPS_SCENE_MODEL_STAR 1
+
+const char *props_scene_models[PROPS_SCENE_MODEL_COUNT] = {
+    "coin",
+    "star",
+};
+
+SceneInstance props_scene[PROPS_SCENE_INSTANCE_COUNT] = {
+    { 0, -3000, -2000, 0, 0, 0, 0, 4096, 4096, 4096, 3, 0xFFFFFFFF },  // Coin
+    { 1, 3000, -2000, 0, 0, 0, 0, 4096, 4096, 4096, 2, 0xFFFFFFFF },  // Star
+};
+
+#endif
@@ -0,0 +1,34 @@
+// PlayStation 1 Animation Table
+// Model: rika
+// Actions: 2
+
+#ifndef RIKA_ACTIONS_H
+#define RIKA_ACTIONS_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+#include "rika-idle.h"
+#include "rika-walk.h"
+
+#ifndef ANIMACTION_DEFINED
+#define ANIMACTION_DEFINED
+typedef struct {
+    const char *name;     // Action name
+    int frame_count;      // Number of baked frames
+    int vertex_count;     // Vertices per frame
+    SVECTOR *frames;      // frame_count * vertex_count vertices
+    int fps;              // Playback rate the action was baked at
+} AnimAction;
+#endif
+
+#define RIKA_ACTIONS_COUNT 2
+#define RIKA_ACTION_IDLE 0
+#define RIKA_ACTION_WALK 1
+
+AnimAction rika_actions[RIKA_ACTIONS_COUNT] = {
+    { "idle", IDLE_FRAMES_COUNT, IDLE_VERTICES_COUNT, &idle_anim[0][0], 30 },
+    { "walk", WALK_FRAMES_COUNT, WALK_VERTICES_COUNT, &walk_anim[0][0], 30 },
+};
+
+#endif
@@ -4537,6 +4537,42 @@ unsigned char rika_mesh_ids[RIKA_FACES_COUNT] = {
     8,  // UpperLeg
 };
 
+// Sub-mesh face ranges { start, count } (faces are ordered by mesh)
+#define RIKA_MESH_COUNT 9
+#define RIKA_MESH_BODY 0
+#define RIKA_MESH_FOOT 1
+#define RIKA_MESH_HAND 2
+#define RIKA_MESH_HEAD 3
+#define RIKA_MESH_LOWERARM 4
+#define RIKA_MESH_LOWERLEG 5
+#define RIKA_MESH_NECK 6
+#define RIKA_MESH_UPPERARM 7
+#define RIKA_MESH_UPPERLEG 8
+
+unsigned short rika_tri_ranges[RIKA_MESH_COUNT][2] = {
+    { 0, 28 },  // Body
+    { 28, 24 },  // Foot
+    { 52, 52 },  // Hand
+    { 104, 54 },  // Head
+    { 158, 14 },  // LowerArm
+    { 172, 24 },  // LowerLeg
+    { 196, 0 },  // Neck
+    { 196, 12 },  // UpperArm
+    { 208, 2 },  // UpperLeg
+};
+
+unsigned short rika_quad_ranges[RIKA_MESH_COUNT][2] = {
+    { 0, 70 },  // Body
+    { 70, 38 },  // Foot
+    { 108, 18 },  // Hand
+    { 126, 71 },  // Head
+    { 197, 22 },  // LowerArm
+    { 219, 14 },  // LowerLeg
+    { 233, 8 },  // Neck
+    { 241, 12 },  // UpperArm
+    { 253, 14 },  // UpperLeg
+};
+
 // Vertex Colors
 #define RIKA_VERTEX_COLORS_COUNT 1
 CVECTOR rika_vertex_colors[RIKA_VERTEX_COLORS_COUNT] = {
@@ -1,41 +1,264 @@
 #include "animation.h"
-#include "chardata/rika-idle.h"
-#include "chardata/rika-walk.h"
+#include <string.h>
 
-// Animation state
-int current_anim = 0;  // 0 = idle, 1 = walk
-int current_frame = 0;
-int frame_timer = 0;
+//----------------------------------------------------------
+// Advance a playback position by elapsed vsyncs
+// Frames advanced = vsyncs * fps / refresh rate, scaled by playback speed
+//----------------------------------------------------------
+static long advanceAnimTime(const AnimAction *action, long time, int vsyncs, int speed, int flags) {
+    long length = (long)action->frame_count << 12;
 
-void initAnimation(void) {
-    current_anim = 0;
-    current_frame = 0;
-    frame_timer = 0;
+    time += ((long)vsyncs * action->fps * speed) / ANIM_VSYNC_RATE;
+
+    if (time >= length) {
+        if (flags & ANIM_FLAG_LOOP) {
+            time %= length;
+        } else {
+            time = length - ONE;  // Hold last frame
+        }
+    }
+    return time;
 }
 
-int getAnimFrameCount(void) {
-    if (current_anim == 0) {
-        return IDLE_FRAMES_COUNT;
-    } else {
-        return WALK_FRAMES_COUNT;
+static SVECTOR* getActionFrame(const AnimAction *action, long time) {
+    return action->frames + (time >> 12) * action->vertex_count;
+}
+
+//----------------------------------------------------------
+// Shared frame cache
+//----------------------------------------------------------
+typedef struct {
+    const AnimAction *action;  // NULL = empty entry
+    short frame;
+    short phase;
+    u_long stamp;              // Frame the entry was last handed out
+} AnimCacheEntry;
+
+static AnimCacheEntry anim_cache[ANIM_CACHE_ENTRIES];
+static SVECTOR anim_cache_verts[ANIM_CACHE_ENTRIES][ANIM_CACHE_MAX_VERTS];
+static u_long anim_cache_stamp = 1;
+
+int anim_cache_hits = 0;
+int anim_cache_misses = 0;
+
+void beginAnimCacheFrame(void) {
+    anim_cache_stamp++;
+    anim_cache_hits = 0;
+    anim_cache_misses = 0;
+}
+
+SVECTOR* getAnimCachedFrame(const AnimAction *action, int frame, int phase) {
+    AnimCacheEntry *entry;
+    AnimCacheEntry *victim = NULL;
+    int next;
+    int i;
+
+    if (action->vertex_count > ANIM_CACHE_MAX_VERTS) {
+        return NULL;
+    }
+
+    for (i = 0; i < ANIM_CACHE_ENTRIES; i++) {
+        entry = &anim_cache[i];
+        if (entry->action == action && entry->frame == frame && entry->phase == phase) {
+            entry->stamp = anim_cache_stamp;
+            anim_cache_hits++;
+            return anim_cache_verts[i];
+        }
+        // Least recently used entry not already handed out this frame
+        if (entry->stamp != anim_cache_stamp && (!victim || entry->stamp < victim->stamp)) {
+            victim = entry;
+        }
+    }
+
+    if (!victim) {
+        return NULL;  // Every entry is in use this frame
+    }
+
+    next = frame + 1 < action->frame_count ? frame + 1 : 0;
+    i = victim - anim_cache;
+    lerpAnimVerts(action->frames + frame * action->vertex_count,
+                  action->frames + next * action->vertex_count,
+                  phase << (12 - ANIM_PHASE_BITS), anim_cache_verts[i], action->vertex_count);
+
+    victim->action = action;
+    victim->frame = frame;
+    victim->phase = phase;
+    victim->stamp = anim_cache_stamp;
+    anim_cache_misses++;
+    return anim_cache_verts[i];
+}
+
+//----------------------------------------------------------
+// Resolve the pose at a playback position
+// Interpolated poses come from the shared cache; exact frames and
+// cache overflow fall back to the baked frame itself
+//----------------------------------------------------------
+static SVECTOR* resolveAnimPose(const AnimAction *action, long time, int flags) {
+    SVECTOR *verts;
+    int phase;
+
+    if (!(flags & ANIM_FLAG_INTERPOLATE)) {
+        return getActionFrame(action, time);
+    }
+
+    phase = (time & (ONE - 1)) >> (12 - ANIM_PHASE_BITS);
+    if (phase == 0) {
+        return getActionFrame(action, time);
+    }
+
+    // The cache mixes the last frame towards frame 0; without looping the
+    // last frame has nothing to mix towards and is held as baked
+    if (!(flags & ANIM_FLAG_LOOP) && (time >> 12) >= action->frame_count - 1) {
+        return getActionFrame(action, time);
+    }
+
+    verts = getAnimCachedFrame(action, time >> 12, phase);
+    return verts ? verts : getActionFrame(action, time);
+}
+
+void initAnimPlayer(AnimPlayer *player, const AnimAction *actions, int action_count) {
+    player->actions = actions;
+    player->action_count = action_count;
+    player->action = 0;
+    player->time = 0;
+    player->speed = ONE;
+    player->flags = ANIM_FLAG_LOOP;
+    player->blend_from = -1;
+    player->blend_from_time = 0;
+    player->blend_vsyncs = 0;
+    player->blend_elapsed = 0;
+    player->blend_buffer = NULL;
+    player->verts = actions[0].frames;
+}
+
+void playAnimAction(AnimPlayer *player, int action) {
+    if (action < 0 || action >= player->action_count) {
+        return;
+    }
+    player->action = action;
+    player->time = 0;
+    player->blend_from = -1;
+    player->verts = player->actions[action].frames;
+}
+
+void setAnimBlendBuffer(AnimPlayer *player, SVECTOR *buffer) {
+    player->blend_buffer = buffer;
+}
+
+//----------------------------------------------------------
+// Pose a crossfade fades out of: the frozen snapshot, or the
+// outgoing action at its own playback position
+//----------------------------------------------------------
+static SVECTOR* getBlendSource(AnimPlayer *player) {
+    if (player->blend_from == ANIM_BLEND_SNAPSHOT) {
+        return player->blend_buffer + player->actions[player->action].vertex_count;
     }
+    return resolveAnimPose(&player->actions[player->blend_from], player->blend_from_time, player->flags);
 }
 
-SVECTOR* getCurrentAnimVerts(void) {
-    if (current_anim == 0) {
-        return idle_anim[current_frame];
+void blendAnimAction(AnimPlayer *player, int action, int blend_vsyncs) {
+    int count;
+
+    if (action < 0 || action >= player->action_count || action == player->action) {
+        return;
+    }
+
+    // No scratch space (or mismatched vertex counts): snap like playAnimAction
+    if (!player->blend_buffer || blend_vsyncs <= 0 ||
+        player->actions[action].vertex_count != player->actions[player->action].vertex_count) {
+        playAnimAction(player, action);
+        return;
+    }
+    count = player->actions[action].vertex_count;
+
+    if (player->blend_from != -1) {
+        // Interrupting a crossfade: starting over from either action would pop,
+        // so the mixed pose on screen is frozen and becomes the source
+        SVECTOR *snapshot = player->blend_buffer + count;
+        memcpy(snapshot, player->verts, count * sizeof(SVECTOR));
+        player->blend_from = ANIM_BLEND_SNAPSHOT;
     } else {
-        return walk_anim[current_frame];
+        // The outgoing action keeps playing while it fades out
+        player->blend_from = player->action;
+        player->blend_from_time = player->time;
+    }
+    player->blend_vsyncs = blend_vsyncs;
+    player->blend_elapsed = 0;
+    player->action = action;
+    player->time = 0;
+
+    lerpAnimVerts(getBlendSource(player), player->actions[action].frames,
+                  0, player->blend_buffer, count);
+    player->verts = player->blend_buffer;
+}
+
+//----------------------------------------------------------
+// Fixed-point linear mix, two vertices per iteration
+//----------------------------------------------------------
+void lerpAnimVerts(const SVECTOR *a, const SVECTOR *b, int t, SVECTOR *out, int count) {
+    const SVECTOR *end = a + (count & ~1);
+
+    while (a < end) {
+        out[0].vx = a[0].vx + (((b[0].vx - a[0].vx) * t) >> 12);
+        out[0].vy = a[0].vy + (((b[0].vy - a[0].vy) * t) >> 12);
+        out[0].vz = a[0].vz + (((b[0].vz - a[0].vz) * t) >> 12);
+        out[1].vx = a[1].vx + (((b[1].vx - a[1].vx) * t) >> 12);
+        out[1].vy = a[1].vy + (((b[1].vy - a[1].vy) * t) >> 12);
+        out[1].vz = a[1].vz + (((b[1].vz - a[1].vz) * t) >> 12);
+        a += 2;
+        b += 2;
+        out += 2;
+    }
+
+    if (count & 1) {
+        out->vx = a->vx + (((b->vx - a->vx) * t) >> 12);
+        out->vy = a->vy + (((b->vy - a->vy) * t) >> 12);
+        out->vz = a->vz + (((b->vz - a->vz) * t) >> 12);
     }
 }
 
-void updateAnimation(void) {
-    frame_timer++;
-    if (frame_timer >= ANIM_SPEED) {
-        frame_timer = 0;
-        current_frame++;
-        if (current_frame >= getAnimFrameCount()) {
-            current_frame = 0;  // Loop
+void updateAnimPlayer(AnimPlayer *player, int vsyncs) {
+    const AnimAction *action = &player->actions[player->action];
+
+    // Paused players still resolve their pose so cached frames stay pinned
+    if (player->flags & ANIM_FLAG_PAUSED) {
+        vsyncs = 0;
+    }
+
+    // Driven by elapsed vsyncs so dropped frames do not slow the animation down
+    player->time = advanceAnimTime(action, player->time, vsyncs, player->speed, player->flags);
+
+    if (player->blend_from != -1) {
+        int weight;
+
+        player->blend_elapsed += vsyncs;
+        if (player->blend_elapsed < player->blend_vsyncs) {
+            if (player->blend_from >= 0) {
+                player->blend_from_time = advanceAnimTime(&player->actions[player->blend_from], player->blend_from_time,
+                                                          vsyncs, player->speed, player->flags);
+            }
+            weight = (player->blend_elapsed << 12) / player->blend_vsyncs;
+
+            lerpAnimVerts(getBlendSource(player),
+                          resolveAnimPose(action, player->time, player->flags),
+                          weight, player->blend_buffer, action->vertex_count);
+            player->verts = player->blend_buffer;
+            return;
         }
+        player->blend_from = -1;  // Crossfade finished
     }
+
+    player->verts = resolveAnimPose(action, player->time, player->flags);
+}
+
+int getAnimPlayerFrameCount(AnimPlayer *player) {
+    return player->actions[player->action].frame_count;
+}
+
+int getAnimPlayerFrame(AnimPlayer *player) {
+    return player->time >> 12;
+}
+
+SVECTOR* getAnimPlayerVerts(AnimPlayer *player) {
+    return player->verts;
 }
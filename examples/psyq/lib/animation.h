@@ -4,23 +4,103 @@
 #include <sys/types.h>
 #include <libgte.h>
 
-// Animation state
-extern int current_anim;     // 0 = idle, 1 = walk
-extern int current_frame;
-extern int frame_timer;
+// Action table entry (matches the <model>-actions.h exporter output)
+#ifndef ANIMACTION_DEFINED
+#define ANIMACTION_DEFINED
+typedef struct {
+    const char *name;     // Action name
+    int frame_count;      // Number of baked frames
+    int vertex_count;     // Vertices per frame
+    SVECTOR *frames;      // frame_count * vertex_count vertices
+    int fps;              // Playback rate the action was baked at
+} AnimAction;
+#endif
 
-#define ANIM_SPEED 2  // Update every 2 vsyncs
+// Display refresh rate used to convert vsyncs to animation time (NTSC)
+#ifndef ANIM_VSYNC_RATE
+#define ANIM_VSYNC_RATE 60
+#endif
 
-// Initialize animation system
-void initAnimation(void);
+// Playback flags
+#define ANIM_FLAG_LOOP        (1 << 0)  // Wrap to frame 0 at the end of the action
+#define ANIM_FLAG_PAUSED      (1 << 1)  // Time does not advance
+#define ANIM_FLAG_INTERPOLATE (1 << 2)  // Mix neighbouring frames by playback phase
 
-// Get current animation frame count
-int getAnimFrameCount(void);
+// blend_from value while fading out of a frozen pose (a crossfade interrupted
+// by another blendAnimAction) instead of a playing action
+#define ANIM_BLEND_SNAPSHOT  -2
 
-// Get current animation vertices
-SVECTOR* getCurrentAnimVerts(void);
+// Shared frame cache: interpolated frames are produced once per
+// (action, frame, phase) and shared by every player showing that pose.
+// Phase is quantized to ANIM_PHASE_BITS so nearby players hit the same entry.
+#ifndef ANIM_CACHE_ENTRIES
+#define ANIM_CACHE_ENTRIES   8
+#endif
+#ifndef ANIM_CACHE_MAX_VERTS
+#define ANIM_CACHE_MAX_VERTS 512
+#endif
+#define ANIM_PHASE_BITS      3
 
-// Update animation (call once per frame)
-void updateAnimation(void);
+// Per-instance animation player
+// time is the playback position in frames, 20.12 fixed point (ONE = 1 frame)
+typedef struct {
+    const AnimAction *actions;  // Action table (e.g. rika_actions)
+    int action_count;
+    int action;                 // Index of the playing action
+    long time;                  // Playback position (frames << 12)
+    int speed;                  // Playback rate, ONE = baked fps
+    int flags;
+    
+    // Crossfade state
+    int blend_from;             // Action fading out, -1 when not blending, ANIM_BLEND_SNAPSHOT for a frozen pose
+    long blend_from_time;       // Playback position of the fading action
+    int blend_vsyncs;           // Crossfade length in vsyncs
+    int blend_elapsed;          // Vsyncs since the crossfade started
+    SVECTOR *blend_buffer;      // Scratch, 2 * vertex_count entries: mixed output, then the frozen pose
+    
+    SVECTOR *verts;             // Pose resolved by the last update
+} AnimPlayer;
+
+// Cache statistics for the current frame
+extern int anim_cache_hits;
+extern int anim_cache_misses;
+
+// Start a new frame: unpins cache entries handed out last frame
+// Call once per frame before updating any players
+void beginAnimCacheFrame(void);
+
+// Get the pose for (action, frame, phase), interpolating on a cache miss
+// phase is 0..(1 << ANIM_PHASE_BITS)-1; the last frame mixes towards frame 0
+// as for a looping action. Returns NULL if every entry is pinned
+SVECTOR* getAnimCachedFrame(const AnimAction *action, int frame, int phase);
+
+// Initialize a player on an action table, playing action 0
+void initAnimPlayer(AnimPlayer *player, const AnimAction *actions, int action_count);
+
+// Switch to an action and restart it from frame 0
+void playAnimAction(AnimPlayer *player, int action);
+
+// Set the scratch buffer crossfades are mixed into (2 * vertex_count entries)
+void setAnimBlendBuffer(AnimPlayer *player, SVECTOR *buffer);
+
+// Crossfade from the playing action to a new one over blend_vsyncs vsyncs
+// Called mid-crossfade, the pose on screen is frozen and faded out instead
+// Falls back to playAnimAction if no blend buffer is set
+void blendAnimAction(AnimPlayer *player, int action, int blend_vsyncs);
+
+// Linearly mix two vertex frames: out = a + (b - a) * t / ONE
+void lerpAnimVerts(const SVECTOR *a, const SVECTOR *b, int t, SVECTOR *out, int count);
+
+// Advance playback by the number of vsyncs elapsed since the last update
+void updateAnimPlayer(AnimPlayer *player, int vsyncs);
+
+// Get current action frame count
+int getAnimPlayerFrameCount(AnimPlayer *player);
+
+// Get current frame index
+int getAnimPlayerFrame(AnimPlayer *player);
+
+// Get the pose resolved by the last update (the blend buffer while crossfading)
+SVECTOR* getAnimPlayerVerts(AnimPlayer *player);
 
 #endif // ANIMATION_H
@@ -1,9 +1,16 @@
 #include "camera.h"
+#include "display.h"
 
 // Camera state
 MATRIX view_matrix;
 SVECTOR camera_rotation = {0, 0, 0};
 VECTOR camera_position = {0, -12800, -20800};  // Camera position in world space (moved back for h=512)
+u_long view_version = 1;
+
+// Inputs the current view matrix was built from
+static SVECTOR last_rotation;
+static VECTOR last_position;
+static int view_valid = 0;
 
 void initCamera(void) {
     camera_rotation.vx = 0;
@@ -17,6 +24,19 @@ void initCamera(void) {
 void updateViewMatrix(void) {
     // GTE uses inverted camera position for view transform
     VECTOR view_translation;
+    
+    // Nothing moved: keep the matrix (and view_version) as they are
+    if (view_valid &&
+        camera_rotation.vx == last_rotation.vx && camera_rotation.vy == last_rotation.vy &&
+        camera_rotation.vz == last_rotation.vz && camera_position.vx == last_position.vx &&
+        camera_position.vy == last_position.vy && camera_position.vz == last_position.vz) {
+        return;
+    }
+    last_rotation = camera_rotation;
+    last_position = camera_position;
+    view_valid = 1;
+    view_version++;
+    
     view_translation.vx = -camera_position.vx;
     view_translation.vy = -camera_position.vy;
     view_translation.vz = -camera_position.vz;
@@ -25,3 +45,25 @@ void updateViewMatrix(void) {
     ApplyMatrixLV(&view_matrix, &view_translation, &view_translation);
     TransMatrix(&view_matrix, &view_translation);
 }
+
+//----------------------------------------------------------
+// Frustum test
+// A point is inside a side plane when |x| * H <= z * (W / 2); the sphere
+// is pushed out by radius times the plane normal's length, bounded by
+// H + half-extent / 2 (>= sqrt(H^2 + half-extent^2) for H >= half-extent)
+//----------------------------------------------------------
+int isSphereVisible(long x, long y, long z, long radius) {
+    if (z + radius <= 0) {
+        return 0;  // Behind the camera
+    }
+    if (x < 0) x = -x;
+    if (y < 0) y = -y;
+    
+    if (x * GEOM_SCREEN_H - z * (SCREEN_WIDTH / 2) > radius * (GEOM_SCREEN_H + SCREEN_WIDTH / 4)) {
+        return 0;
+    }
+    if (y * GEOM_SCREEN_H - z * (SCREEN_HEIGHT / 2) > radius * (GEOM_SCREEN_H + SCREEN_HEIGHT / 4)) {
+        return 0;
+    }
+    return 1;
+}
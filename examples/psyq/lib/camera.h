@@ -9,10 +9,17 @@ extern MATRIX view_matrix;
 extern SVECTOR camera_rotation;
 extern VECTOR camera_position;
 
+// Bumped whenever updateViewMatrix produces a different matrix
+extern u_long view_version;
+
 // Initialize camera
 void initCamera(void);
 
 // Update view matrix from camera position/rotation
 void updateViewMatrix(void);
 
+// Test a view-space bounding sphere against the view frustum
+// Conservative: may accept spheres just outside the screen edges
+int isSphereVisible(long x, long y, long z, long radius);
+
 #endif // CAMERA_H
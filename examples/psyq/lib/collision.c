@@ -0,0 +1,323 @@
+/*
+ * Collision mesh with spatial hash queries implementation
+ */
+
+#include "collision.h"
+
+//----------------------------------------------------------
+// Spatial hash
+//----------------------------------------------------------
+static int hashCell(long cx, long cz) {
+    return (int)(((u_long)cx * 73856093u) ^ ((u_long)cz * 19349663u)) & (COLLISION_HASH_SIZE - 1);
+}
+
+//----------------------------------------------------------
+// X/Z cell range covered by a triangle
+//----------------------------------------------------------
+static void getTriCells(CollisionMesh *col, int tri, long *cx0, long *cz0, long *cx1, long *cz1) {
+    SVECTOR *a = &col->vertices[col->tris[tri][0]];
+    SVECTOR *b = &col->vertices[col->tris[tri][1]];
+    SVECTOR *c = &col->vertices[col->tris[tri][2]];
+    long min_x = a->vx, max_x = a->vx, min_z = a->vz, max_z = a->vz;
+    
+    if (b->vx < min_x) min_x = b->vx;
+    if (c->vx < min_x) min_x = c->vx;
+    if (b->vx > max_x) max_x = b->vx;
+    if (c->vx > max_x) max_x = c->vx;
+    if (b->vz < min_z) min_z = b->vz;
+    if (c->vz < min_z) min_z = c->vz;
+    if (b->vz > max_z) max_z = b->vz;
+    if (c->vz > max_z) max_z = c->vz;
+    
+    *cx0 = min_x >> col->cell_shift;
+    *cz0 = min_z >> col->cell_shift;
+    *cx1 = max_x >> col->cell_shift;
+    *cz1 = max_z >> col->cell_shift;
+}
+
+int initCollisionMesh(
+    CollisionMesh *col,
+    SVECTOR *vertices,
+    unsigned short (*tris)[3],
+    SVECTOR *normals,
+    int tri_count,
+    int cell_shift
+) {
+    static unsigned short cursor[COLLISION_HASH_SIZE];
+    long cx0, cz0, cx1, cz1, cx, cz;
+    u_long total = 0;
+    int result = 0;
+    int i;
+    
+    if (tri_count > COLLISION_MAX_TRIS) {
+        tri_count = COLLISION_MAX_TRIS;
+        result = -1;
+    }
+    
+    col->tri_count = tri_count;
+    col->vertices = vertices;
+    col->tris = tris;
+    col->normals = normals;
+    col->cell_shift = cell_shift;
+    col->stamp = 0;
+    
+    for (i = 0; i <= COLLISION_HASH_SIZE; i++) {
+        col->bucket_start[i] = 0;
+    }
+    for (i = 0; i < tri_count; i++) {
+        col->stamps[i] = 0;
+    }
+    
+    // Count entries per bucket (stored shifted by one for the prefix sum)
+    for (i = 0; i < tri_count; i++) {
+        getTriCells(col, i, &cx0, &cz0, &cx1, &cz1);
+        for (cz = cz0; cz <= cz1; cz++) {
+            for (cx = cx0; cx <= cx1; cx++) {
+                col->bucket_start[hashCell(cx, cz) + 1]++;
+                total++;
+            }
+        }
+    }
+    if (total > COLLISION_MAX_ENTRIES) {
+        // Not enough room: leave the hash empty rather than half built
+        for (i = 0; i <= COLLISION_HASH_SIZE; i++) {
+            col->bucket_start[i] = 0;
+        }
+        return -1;
+    }
+    
+    for (i = 0; i < COLLISION_HASH_SIZE; i++) {
+        col->bucket_start[i + 1] += col->bucket_start[i];
+        cursor[i] = col->bucket_start[i];
+    }
+    
+    // Fill
+    for (i = 0; i < tri_count; i++) {
+        getTriCells(col, i, &cx0, &cz0, &cx1, &cz1);
+        for (cz = cz0; cz <= cz1; cz++) {
+            for (cx = cx0; cx <= cx1; cx++) {
+                col->entries[cursor[hashCell(cx, cz)]++] = i;
+            }
+        }
+    }
+    
+    return result;
+}
+
+//----------------------------------------------------------
+// Start a query: every triangle is visited at most once per stamp
+//----------------------------------------------------------
+static void beginQuery(CollisionMesh *col) {
+    if (++col->stamp == 0) {
+        int i;
+        for (i = 0; i < col->tri_count; i++) {
+            col->stamps[i] = 0;
+        }
+        col->stamp = 1;
+    }
+}
+
+//----------------------------------------------------------
+// 2D edge tests: is (px, py) inside triangle a, b, c?
+// Differences are pre-shifted so products stay within 32 bits
+//----------------------------------------------------------
+static int insideTri2D(long ax, long ay, long bx, long by, long cx, long cy, long px, long py) {
+    long e0 = ((bx - ax) >> 2) * ((py - ay) >> 2) - ((by - ay) >> 2) * ((px - ax) >> 2);
+    long e1 = ((cx - bx) >> 2) * ((py - by) >> 2) - ((cy - by) >> 2) * ((px - bx) >> 2);
+    long e2 = ((ax - cx) >> 2) * ((py - cy) >> 2) - ((ay - cy) >> 2) * ((px - cx) >> 2);
+    
+    return (e0 >= 0 && e1 >= 0 && e2 >= 0) || (e0 <= 0 && e1 <= 0 && e2 <= 0);
+}
+
+//----------------------------------------------------------
+// Is a point on a triangle's plane inside the triangle?
+// Projects onto the plane most facing the normal
+//----------------------------------------------------------
+static int insideTri(CollisionMesh *col, int tri, long x, long y, long z) {
+    SVECTOR *n = &col->normals[tri];
+    SVECTOR *a = &col->vertices[col->tris[tri][0]];
+    SVECTOR *b = &col->vertices[col->tris[tri][1]];
+    SVECTOR *c = &col->vertices[col->tris[tri][2]];
+    long nx = n->vx < 0 ? -n->vx : n->vx;
+    long ny = n->vy < 0 ? -n->vy : n->vy;
+    long nz = n->vz < 0 ? -n->vz : n->vz;
+    
+    if (ny >= nx && ny >= nz) {
+        return insideTri2D(a->vx, a->vz, b->vx, b->vz, c->vx, c->vz, x, z);
+    }
+    if (nx >= nz) {
+        return insideTri2D(a->vy, a->vz, b->vy, b->vz, c->vy, c->vz, y, z);
+    }
+    return insideTri2D(a->vx, a->vy, b->vx, b->vy, c->vx, c->vy, x, y);
+}
+
+//----------------------------------------------------------
+// Signed distance from a point to a triangle's plane
+//----------------------------------------------------------
+static long planeDistance(CollisionMesh *col, int tri, long x, long y, long z) {
+    SVECTOR *n = &col->normals[tri];
+    SVECTOR *a = &col->vertices[col->tris[tri][0]];
+    
+    return ((n->vx * (x - a->vx)) >> 12) + ((n->vy * (y - a->vy)) >> 12) + ((n->vz * (z - a->vz)) >> 12);
+}
+
+int getGroundHeight(CollisionMesh *col, long x, long y, long z, long *height) {
+    int bucket = hashCell(x >> col->cell_shift, z >> col->cell_shift);
+    int found = 0;
+    int e;
+    
+    beginQuery(col);
+    for (e = col->bucket_start[bucket]; e < col->bucket_start[bucket + 1]; e++) {
+        int tri = col->entries[e];
+        SVECTOR *n = &col->normals[tri];
+        SVECTOR *a;
+        long h;
+        
+        if (col->stamps[tri] == col->stamp || -n->vy < COLLISION_FLOOR_NY) {
+            continue;
+        }
+        col->stamps[tri] = col->stamp;
+        
+        a = &col->vertices[col->tris[tri][0]];
+        if (!insideTri2D(a->vx, a->vz,
+                         col->vertices[col->tris[tri][1]].vx, col->vertices[col->tris[tri][1]].vz,
+                         col->vertices[col->tris[tri][2]].vx, col->vertices[col->tris[tri][2]].vz, x, z)) {
+            continue;
+        }
+        
+        // Solve n . (p - a) = 0 for p.y
+        h = a->vy - (n->vx * (x - a->vx) + n->vz * (z - a->vz)) / n->vy;
+        
+        // Nearest floor under (or just above) the point
+        if (h >= y - COLLISION_STEP_HEIGHT && (!found || h < *height)) {
+            *height = h;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+//----------------------------------------------------------
+// Test one hash bucket against a ray, keeping the nearest hit
+//----------------------------------------------------------
+static void raycastBucket(CollisionMesh *col, int bucket, VECTOR *origin, SVECTOR *dir, long max_dist, CollisionHit *hit, int *found) {
+    int e;
+    
+    for (e = col->bucket_start[bucket]; e < col->bucket_start[bucket + 1]; e++) {
+        int tri = col->entries[e];
+        SVECTOR *n = &col->normals[tri];
+        long denom, t, px, py, pz;
+        
+        if (col->stamps[tri] == col->stamp) {
+            continue;
+        }
+        col->stamps[tri] = col->stamp;
+        
+        denom = (n->vx * dir->vx + n->vy * dir->vy + n->vz * dir->vz) >> 12;
+        if (denom == 0) {
+            continue;  // Parallel to the plane
+        }
+        
+        // Distance along the ray to the plane
+        t = -(planeDistance(col, tri, origin->vx, origin->vy, origin->vz) << 12) / denom;
+        if (t < 0 || t > max_dist || (*found && t >= hit->distance)) {
+            continue;
+        }
+        
+        px = origin->vx + ((dir->vx * t) >> 12);
+        py = origin->vy + ((dir->vy * t) >> 12);
+        pz = origin->vz + ((dir->vz * t) >> 12);
+        if (!insideTri(col, tri, px, py, pz)) {
+            continue;
+        }
+        
+        hit->distance = t;
+        hit->point.vx = px;
+        hit->point.vy = py;
+        hit->point.vz = pz;
+        hit->tri = tri;
+        *found = 1;
+    }
+}
+
+int raycastCollision(CollisionMesh *col, VECTOR *origin, SVECTOR *dir, long max_dist, CollisionHit *hit) {
+    long step = col->cell_shift > 0 ? 1L << (col->cell_shift - 1) : 1;  // Half a cell
+    long last_cx, last_cz, t;
+    int found = 0;
+    
+    beginQuery(col);
+    last_cx = origin->vx >> col->cell_shift;
+    last_cz = origin->vz >> col->cell_shift;
+    raycastBucket(col, hashCell(last_cx, last_cz), origin, dir, max_dist, hit, &found);
+    
+    // March the ray through the grid half a cell at a time
+    for (t = step; t < max_dist + step; t += step) {
+        long cx = (origin->vx + ((dir->vx * t) >> 12)) >> col->cell_shift;
+        long cz = (origin->vz + ((dir->vz * t) >> 12)) >> col->cell_shift;
+        
+        if (found && hit->distance < t - step) {
+            break;  // Nothing further along can be nearer
+        }
+        if (cx == last_cx && cz == last_cz) {
+            continue;
+        }
+        
+        // Crossing a corner: also visit the two cells beside the diagonal
+        if (cx != last_cx && cz != last_cz) {
+            raycastBucket(col, hashCell(cx, last_cz), origin, dir, max_dist, hit, &found);
+            raycastBucket(col, hashCell(last_cx, cz), origin, dir, max_dist, hit, &found);
+        }
+        raycastBucket(col, hashCell(cx, cz), origin, dir, max_dist, hit, &found);
+        last_cx = cx;
+        last_cz = cz;
+    }
+    return found;
+}
+
+int collideSphere(CollisionMesh *col, VECTOR *center, long radius, VECTOR *push) {
+    long cx0 = (center->vx - radius) >> col->cell_shift;
+    long cz0 = (center->vz - radius) >> col->cell_shift;
+    long cx1 = (center->vx + radius) >> col->cell_shift;
+    long cz1 = (center->vz + radius) >> col->cell_shift;
+    long cx, cz;
+    int contacts = 0;
+    
+    beginQuery(col);
+    for (cz = cz0; cz <= cz1; cz++) {
+        for (cx = cx0; cx <= cx1; cx++) {
+            int bucket = hashCell(cx, cz);
+            int e;
+            
+            for (e = col->bucket_start[bucket]; e < col->bucket_start[bucket + 1]; e++) {
+                int tri = col->entries[e];
+                SVECTOR *n = &col->normals[tri];
+                long d;
+                
+                if (col->stamps[tri] == col->stamp) {
+                    continue;
+                }
+                col->stamps[tri] = col->stamp;
+                
+                // Only front-side penetration; behind a wall is someone else's problem
+                d = planeDistance(col, tri, center->vx, center->vy, center->vz);
+                if (d < 0 || d >= radius) {
+                    continue;
+                }
+                
+                // Closest point on the plane must lie inside the triangle
+                if (!insideTri(col, tri,
+                               center->vx - ((n->vx * d) >> 12),
+                               center->vy - ((n->vy * d) >> 12),
+                               center->vz - ((n->vz * d) >> 12))) {
+                    continue;
+                }
+                
+                push->vx += (n->vx * (radius - d)) >> 12;
+                push->vy += (n->vy * (radius - d)) >> 12;
+                push->vz += (n->vz * (radius - d)) >> 12;
+                contacts++;
+            }
+        }
+    }
+    return contacts;
+}
@@ -0,0 +1,73 @@
+/*
+ * Collision mesh with spatial hash queries
+ */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+// Spatial hash capacity (buckets must be a power of two)
+#ifndef COLLISION_HASH_SIZE
+#define COLLISION_HASH_SIZE   256
+#endif
+#ifndef COLLISION_MAX_TRIS
+#define COLLISION_MAX_TRIS    2048
+#endif
+#ifndef COLLISION_MAX_ENTRIES
+#define COLLISION_MAX_ENTRIES 8192
+#endif
+
+// Floors face up (-Y) with at least this much of ONE (cos 45 degrees)
+#define COLLISION_FLOOR_NY    2896
+
+// How far above the query point a floor still counts as "under" it
+#define COLLISION_STEP_HEIGHT 256
+
+// Triangle soup (matches the <model>-collision.h exporter output) hashed
+// by X/Z cell. Each triangle is stored in every cell its bounds touch.
+typedef struct {
+    int tri_count;
+    SVECTOR *vertices;
+    unsigned short (*tris)[3];
+    SVECTOR *normals;                                     // Per triangle, ONE = 1.0
+    int cell_shift;                                       // Cell size = 1 << cell_shift
+    unsigned short bucket_start[COLLISION_HASH_SIZE + 1];
+    unsigned short entries[COLLISION_MAX_ENTRIES];
+    unsigned short stamps[COLLISION_MAX_TRIS];            // Query each triangle once
+    unsigned short stamp;
+} CollisionMesh;
+
+// Result of a ray query
+typedef struct {
+    long distance;      // Along the ray from its origin
+    VECTOR point;
+    int tri;            // Triangle index
+} CollisionHit;
+
+// Build the spatial hash. Returns 0, or -1 if the mesh exceeds the
+// compile-time capacity (extra triangles are then ignored)
+int initCollisionMesh(
+    CollisionMesh *col,
+    SVECTOR *vertices,
+    unsigned short (*tris)[3],
+    SVECTOR *normals,
+    int tri_count,
+    int cell_shift
+);
+
+// Height of the nearest floor at (x, z) at or below y (Y grows downward)
+// Returns 1 and writes *height when a floor was found
+int getGroundHeight(CollisionMesh *col, long x, long y, long z, long *height);
+
+// First triangle hit by a ray; dir is a unit vector (ONE = 1.0)
+// Returns 1 and fills *hit when something is within max_dist
+int raycastCollision(CollisionMesh *col, VECTOR *origin, SVECTOR *dir, long max_dist, CollisionHit *hit);
+
+// Push a sphere out of every triangle it penetrates from the front
+// Adds the correction to *push (sliding along walls when applied after a
+// move) and returns the number of contacts
+int collideSphere(CollisionMesh *col, VECTOR *center, long radius, VECTOR *push);
+
+#endif // COLLISION_H
@@ -13,6 +13,10 @@ char *nextpri;
 // Font stream ID
 int fontId = -1;
 
+// Frame timing
+int frameVSyncs = 1;
+static int lastVSync = 0;
+
 void initDisplay(void) {
     ResetGraph(0);
     
@@ -35,9 +39,16 @@ void initDisplay(void) {
     fontId = FntOpen(16, 16, 288, 64, 0, 512);
     
     SetDispMask(1);
+    
+    lastVSync = VSync(-1);
 }
 
 void swapBuffers(void) {
+    // VSync(-1) returns the vblank counter since boot
+    int now = VSync(-1);
+    frameVSyncs = now - lastVSync;
+    lastVSync = now;
+    
     currentBuffer = !currentBuffer;
     cdb = &db[currentBuffer];
     nextpri = primbuff[currentBuffer];
@@ -7,7 +7,14 @@
 
 #define SCREEN_WIDTH  320
 #define SCREEN_HEIGHT 240
+#define GEOM_SCREEN_H 512  // GTE projection distance (SetGeomScreen)
+
+// Frame ordering table length. Objects drawn through local OTs
+// (see ordering.h) only need one entry each, so a smaller frame OT can
+// be built with e.g. -DOT_LENGTH=1024 -DOTZ_SHIFT=4
+#ifndef OT_LENGTH
 #define OT_LENGTH     4096
+#endif
 
 // Double buffer structure
 typedef struct {
@@ -28,10 +35,13 @@ extern char *nextpri;
 // Font stream ID
 extern int fontId;
 
+// Vsyncs elapsed between the last two buffer swaps (drives animation time)
+extern int frameVSyncs;
+
 // Initialize display system
 void initDisplay(void);
 
-// Swap display buffers
+// Swap display buffers and update frameVSyncs
 void swapBuffers(void);
 
 #endif // DISPLAY_H
@@ -0,0 +1,94 @@
+/*
+ * Cached drawing implementation
+ */
+
+#include "drawcache.h"
+
+//----------------------------------------------------------
+// Compare two GTE matrices (rotation and translation)
+//----------------------------------------------------------
+static int matrixEqual(MATRIX *a, MATRIX *b) {
+    int i, j;
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            if (a->m[i][j] != b->m[i][j]) {
+                return 0;
+            }
+        }
+        if (a->t[i] != b->t[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void initDrawCache(DrawCache *cache, char *buf0, char *buf1, u_long size) {
+    cache->prims[0] = buf0;
+    cache->prims[1] = buf1;
+    cache->prim_size = size;
+    markDrawCacheDirty(cache);
+}
+
+void markDrawCacheDirty(DrawCache *cache) {
+    cache->valid[0] = 0;
+    cache->valid[1] = 0;
+}
+
+int renderModelCached(
+    DrawCache *cache,
+    int buffer,
+    SVECTOR *verts,
+    ModelData *model,
+    MATRIX *matrix,
+    u_long *ot,
+    int ot_length,
+    int z,
+    u_short tpage,
+    u_short clut
+) {
+    u_long *local_ot = cache->ot[buffer];
+    int shift = getModelOTZShift();
+    long bias = getModelOTZBias();
+    
+    // adaptOTZShift can change the frame mapping, which moves every primitive's slot
+    if (!cache->valid[buffer] || cache->verts[buffer] != verts || !matrixEqual(&cache->matrix[buffer], matrix) ||
+        cache->otz_shift[buffer] != shift || cache->otz_bias[buffer] != bias) {
+        int local_shift = shift;
+        char *end;
+        
+        // renderModel has no bound of its own: refuse models whose worst case
+        // does not fit rather than writing past the buffer
+        if (DRAW_CACHE_BUFFER_SIZE(model->tri_count + model->quad_count) > cache->prim_size) {
+            cache->valid[buffer] = 0;
+            return 0;
+        }
+        
+        // Same depth range as the frame OT, at the local OT's resolution
+        while ((ot_length >> (local_shift - shift)) > DRAW_CACHE_OT_LENGTH) {
+            local_shift++;
+        }
+        
+        SetRotMatrix(matrix);
+        SetTransMatrix(matrix);
+        
+        ClearOTagR(local_ot, DRAW_CACHE_OT_LENGTH);
+        setModelOTZShift(local_shift);
+        end = renderModel(verts, model, cache->prims[buffer], local_ot, DRAW_CACHE_OT_LENGTH, tpage, clut);
+        setModelOTZShift(shift);
+        
+        if ((u_long)(end - cache->prims[buffer]) > cache->prim_size) {
+            cache->valid[buffer] = 0;
+            return 0;
+        }
+        
+        cache->matrix[buffer] = *matrix;
+        cache->verts[buffer] = verts;
+        cache->otz_shift[buffer] = shift;
+        cache->otz_bias[buffer] = bias;
+        cache->valid[buffer] = 1;
+    }
+    
+    // Splice the whole sub-chain (far end first) into the frame OT
+    AddPrims(&ot[z], &local_ot[DRAW_CACHE_OT_LENGTH - 1], &local_ot[0]);
+    return 1;
+}
@@ -0,0 +1,57 @@
+/*
+ * Cached drawing for static geometry
+ */
+
+#ifndef DRAWCACHE_H
+#define DRAWCACHE_H
+
+#include <sys/types.h>
+#include <libgte.h>
+#include <libgpu.h>
+#include "model.h"
+
+// Entries in each cached object's local ordering table
+#define DRAW_CACHE_OT_LENGTH 256
+
+// Bytes a cache buffer needs for a model with the given face count
+#define DRAW_CACHE_BUFFER_SIZE(faces) (MODEL_PRIM_BUFFER_MAX(faces) + sizeof(DR_STP))
+
+// A model's primitives built once into persistent buffers and kept
+// depth-sorted in a local OT sub-chain, one copy per display buffer.
+// A copy is only rebuilt when the matrix, vertices or OTZ mapping it was
+// built with change; otherwise the sub-chain is just re-linked into the frame OT.
+typedef struct {
+    u_long ot[2][DRAW_CACHE_OT_LENGTH];  // Local sub-chain per display buffer
+    char *prims[2];                      // Persistent primitive buffers
+    u_long prim_size;                    // Bytes available in each buffer
+    MATRIX matrix[2];                    // Matrix each copy was built with
+    SVECTOR *verts[2];                   // Vertices each copy was built with
+    int otz_shift[2];                    // Frame OTZ shift each copy was sorted with
+    long otz_bias[2];                    // Frame OTZ bias each copy was sorted with
+    int valid[2];                        // Copy can be re-linked as is
+} DrawCache;
+
+// Initialize a cache with two primitive buffers of 'size' bytes each
+void initDrawCache(DrawCache *cache, char *buf0, char *buf1, u_long size);
+
+// Force a rebuild of both copies (e.g. after changing visible_meshes)
+void markDrawCacheDirty(DrawCache *cache);
+
+// Render a model through the cache for display buffer 'buffer'
+// matrix is the composed view * world matrix; the object's sub-chain is
+// linked into ot[z] as one block
+// Returns 0 (and draws nothing) if the model's primitives may not fit in prim_size
+int renderModelCached(
+    DrawCache *cache,
+    int buffer,
+    SVECTOR *verts,
+    ModelData *model,
+    MATRIX *matrix,
+    u_long *ot,
+    int ot_length,
+    int z,
+    u_short tpage,
+    u_short clut
+);
+
+#endif // DRAWCACHE_H
@@ -0,0 +1,194 @@
+/*
+ * Structure-of-arrays entity store implementation
+ */
+
+#include "entity.h"
+#include "camera.h"
+#include "animation.h"
+
+// Most instances gathered into one renderModelInstances call
+#define ENTITY_BATCH_MAX 32
+
+void initEntityStore(EntityStore *store, EntityModel *models) {
+    store->count = 0;
+    store->models = models;
+    store->visible_count = 0;
+}
+
+int addEntity(EntityStore *store, int model, long x, long y, long z, int flags) {
+    int i = store->count;
+    
+    if (i >= ENTITY_MAX) {
+        return -1;
+    }
+    
+    store->x[i] = x;
+    store->y[i] = y;
+    store->z[i] = z;
+    store->rx[i] = 0;
+    store->ry[i] = 0;
+    store->rz[i] = 0;
+    store->sx[i] = ONE;
+    store->sy[i] = ONE;
+    store->sz[i] = ONE;
+    store->spin[i] = 0;
+    store->phase[i] = 0;
+    store->model[i] = model;
+    store->flags[i] = flags;
+    store->count++;
+    return i;
+}
+
+void setEntityTransform(EntityStore *store, int index, short rx, short ry, short rz, long sx, long sy, long sz) {
+    store->rx[index] = rx;
+    store->ry[index] = ry;
+    store->rz[index] = rz;
+    store->sx[index] = sx;
+    store->sy[index] = sy;
+    store->sz[index] = sz;
+}
+
+void removeEntity(EntityStore *store, int index) {
+    int last = store->count - 1;
+    
+    if (index < 0 || index > last) {
+        return;
+    }
+    
+    store->x[index] = store->x[last];
+    store->y[index] = store->y[last];
+    store->z[index] = store->z[last];
+    store->rx[index] = store->rx[last];
+    store->ry[index] = store->ry[last];
+    store->rz[index] = store->rz[last];
+    store->sx[index] = store->sx[last];
+    store->sy[index] = store->sy[last];
+    store->sz[index] = store->sz[last];
+    store->spin[index] = store->spin[last];
+    store->phase[index] = store->phase[last];
+    store->model[index] = store->model[last];
+    store->flags[index] = store->flags[last];
+    store->count--;
+}
+
+void updateEntities(EntityStore *store, int vsyncs) {
+    int count = store->count;
+    int i;
+    
+    // Animation pass: touches phase, model and flags only
+    for (i = 0; i < count; i++) {
+        if (store->flags[i] & ENTITY_FLAG_ANIMATED) {
+            EntityModel *m = &store->models[store->model[i]];
+            long length = (long)m->frame_count << 12;
+            
+            store->phase[i] += ((long)vsyncs * m->fps * ONE) / ANIM_VSYNC_RATE;
+            if (store->phase[i] >= length) {
+                store->phase[i] %= length;
+            }
+        }
+    }
+    
+    // Spin pass: touches yaw, spin and flags only
+    for (i = 0; i < count; i++) {
+        if (store->flags[i] & ENTITY_FLAG_SPIN) {
+            store->ry[i] = (store->ry[i] + store->spin[i] * vsyncs) & 4095;
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Model bounding radius grown by the entity's largest axis scale
+//----------------------------------------------------------
+static long getEntityRadius(EntityStore *store, int i) {
+    long largest = store->sx[i];
+    
+    if (store->sy[i] > largest) largest = store->sy[i];
+    if (store->sz[i] > largest) largest = store->sz[i];
+    return (store->models[store->model[i]].radius * largest) >> 12;
+}
+
+void cullEntities(EntityStore *store) {
+    int count = store->count;
+    int visible = 0;
+    int i;
+    
+    for (i = 0; i < count; i++) {
+        VECTOR world;
+        VECTOR view;
+        
+        if (store->flags[i] & ENTITY_FLAG_HIDDEN) {
+            continue;
+        }
+        
+        // View-space centre: view_matrix * position + view translation
+        world.vx = store->x[i];
+        world.vy = store->y[i];
+        world.vz = store->z[i];
+        ApplyMatrixLV(&view_matrix, &world, &view);
+        view.vx += view_matrix.t[0];
+        view.vy += view_matrix.t[1];
+        view.vz += view_matrix.t[2];
+        
+        if (isSphereVisible(view.vx, view.vy, view.vz, getEntityRadius(store, i))) {
+            store->visible[visible++] = i;
+        }
+    }
+    
+    store->visible_count = visible;
+}
+
+//----------------------------------------------------------
+// Vertices an entity is drawn with this frame
+//----------------------------------------------------------
+static SVECTOR* getEntityVerts(EntityStore *store, int i) {
+    EntityModel *m = &store->models[store->model[i]];
+    return m->frames + (store->phase[i] >> 12) * m->vertex_count;
+}
+
+char* renderEntities(EntityStore *store, char *nextpri, char *end, u_long *ot, int ot_length) {
+    static MATRIX matrices[ENTITY_BATCH_MAX];
+    int n = 0;
+    
+    while (n < store->visible_count) {
+        int first = store->visible[n];
+        EntityModel *m = &store->models[store->model[first]];
+        SVECTOR *verts = getEntityVerts(store, first);
+        int batch = 0;
+        
+        // Gather the run that shares a model and frame
+        while (n < store->visible_count && batch < ENTITY_BATCH_MAX) {
+            int i = store->visible[n];
+            MATRIX world;
+            SVECTOR rot;
+            VECTOR pos;
+            VECTOR scale;
+            
+            if (store->model[i] != store->model[first] || getEntityVerts(store, i) != verts) {
+                break;
+            }
+            
+            rot.vx = store->rx[i];
+            rot.vy = store->ry[i];
+            rot.vz = store->rz[i];
+            pos.vx = store->x[i];
+            pos.vy = store->y[i];
+            pos.vz = store->z[i];
+            RotMatrix(&rot, &world);
+            if (store->sx[i] != ONE || store->sy[i] != ONE || store->sz[i] != ONE) {
+                scale.vx = store->sx[i];
+                scale.vy = store->sy[i];
+                scale.vz = store->sz[i];
+                ScaleMatrix(&world, &scale);
+            }
+            TransMatrix(&world, &pos);
+            CompMatrix(&view_matrix, &world, &matrices[batch++]);
+            n++;
+        }
+        
+        // cullEntities already tested every visible entity's sphere
+        nextpri = renderModelInstances(verts, m->model, matrices, NULL, batch,
+                                       m->model->visible_meshes, nextpri, end, ot, ot_length, m->tpage, m->clut);
+    }
+    
+    return nextpri;
+}
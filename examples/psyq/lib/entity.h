@@ -0,0 +1,85 @@
+/*
+ * Structure-of-arrays entity store for pickups and props
+ */
+
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include <sys/types.h>
+#include <libgte.h>
+#include "model.h"
+
+// Capacity of one store
+#ifndef ENTITY_MAX
+#define ENTITY_MAX 256
+#endif
+
+// Entity flags
+#define ENTITY_FLAG_ANIMATED (1 << 0)  // Phase advances through the model's frames
+#define ENTITY_FLAG_SPIN     (1 << 1)  // Yaw advances by spin each vsync
+#define ENTITY_FLAG_HIDDEN   (1 << 2)  // Skipped by the cull pass
+
+// A model entities can use (index = entity model id)
+typedef struct {
+    ModelData *model;
+    SVECTOR *frames;      // frame_count * vertex_count vertices (1 frame = static)
+    int frame_count;
+    int vertex_count;
+    int fps;              // Playback rate of the frames
+    long radius;          // Bounding radius for frustum rejection
+    u_short tpage;
+    u_short clut;
+} EntityModel;
+
+// Entity state, one array per field so each pass streams through only
+// the data it touches. Entities are kept dense: removal swaps the last
+// entity into the hole.
+typedef struct {
+    int count;
+    EntityModel *models;
+    
+    long x[ENTITY_MAX];             // World position
+    long y[ENTITY_MAX];
+    long z[ENTITY_MAX];
+    short rx[ENTITY_MAX];           // Rotation (4096 = 360 degrees)
+    short ry[ENTITY_MAX];
+    short rz[ENTITY_MAX];
+    long sx[ENTITY_MAX];            // Scale (ONE = 1.0)
+    long sy[ENTITY_MAX];
+    long sz[ENTITY_MAX];
+    short spin[ENTITY_MAX];         // Yaw per vsync for ENTITY_FLAG_SPIN
+    long phase[ENTITY_MAX];         // Animation position (frames << 12)
+    unsigned char model[ENTITY_MAX];
+    unsigned char flags[ENTITY_MAX];
+    
+    // Output of the cull pass
+    int visible_count;
+    unsigned short visible[ENTITY_MAX];
+} EntityStore;
+
+// Initialize an empty store using the given model table
+void initEntityStore(EntityStore *store, EntityModel *models);
+
+// Add an entity with no rotation and unit scale; returns its index or
+// -1 when the store is full
+int addEntity(EntityStore *store, int model, long x, long y, long z, int flags);
+
+// Set an entity's rotation (4096 = 360 degrees) and scale (ONE = 1.0),
+// e.g. from an exported SceneInstance
+void setEntityTransform(EntityStore *store, int index, short rx, short ry, short rz, long sx, long sy, long sz);
+
+// Remove an entity (the last entity moves into its index)
+void removeEntity(EntityStore *store, int index);
+
+// Advance animation phases and spins by elapsed vsyncs
+void updateEntities(EntityStore *store, int vsyncs);
+
+// Build the visible list against the current view matrix
+void cullEntities(EntityStore *store);
+
+// Render the visible list; runs of entities sharing a model and frame
+// are drawn as one instanced batch, stopping at 'end' (the end of the
+// primitive buffer). Returns updated nextpri pointer
+char* renderEntities(EntityStore *store, char *nextpri, char *end, u_long *ot, int ot_length);
+
+#endif // ENTITY_H
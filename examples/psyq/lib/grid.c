@@ -0,0 +1,165 @@
+/*
+ * Uniform grid partition implementation
+ */
+
+#include "grid.h"
+#include "camera.h"
+
+// Most cells collected before they are drawn as one batch
+#define GRID_MAX_VISIBLE 256
+
+int grid_cells_tested = 0;
+int grid_cells_drawn = 0;
+int grid_batches = 0;
+
+static unsigned short visible_cells[GRID_MAX_VISIBLE];
+static int visible_count;
+
+// Arguments of the renderModelGrid call being visited
+typedef struct {
+    SVECTOR *verts;
+    ModelData *model;
+    ModelGrid *grid;
+    MATRIX *matrix;
+    char *nextpri;
+    u_long *ot;
+    int ot_length;
+    u_short tpage;
+    u_short clut;
+} GridDraw;
+
+//----------------------------------------------------------
+// Draw the collected cells and empty the list
+//----------------------------------------------------------
+static void flushVisibleCells(GridDraw *draw) {
+    ModelGrid *grid = draw->grid;
+    int i;
+    
+    if (visible_count == 0) {
+        return;
+    }
+    
+    // ApplyMatrixLV replaced the GTE rotation; restore it for rendering
+    SetRotMatrix(draw->matrix);
+    SetTransMatrix(draw->matrix);
+    
+    for (i = 0; i < visible_count; i++) {
+        int cell = visible_cells[i];
+        draw->nextpri = renderModelFaces(draw->verts, draw->model,
+                                         grid->tri_ranges[cell][0], grid->tri_ranges[cell][1],
+                                         grid->quad_ranges[cell][0], grid->quad_ranges[cell][1],
+                                         draw->nextpri, draw->ot, draw->ot_length, draw->tpage, draw->clut);
+    }
+    
+    grid_cells_drawn += visible_count;
+    grid_batches++;
+    visible_count = 0;
+}
+
+//----------------------------------------------------------
+// Upper bound of a vector's length without a square root
+// max + (others) / 2 >= sqrt(a^2 + b^2 + c^2)
+//----------------------------------------------------------
+static long boundLength3(long a, long b, long c) {
+    long t;
+    
+    if (b > a) { t = a; a = b; b = t; }
+    if (c > a) { t = a; a = c; c = t; }
+    return a + ((b + c) >> 1);
+}
+
+//----------------------------------------------------------
+// Test a model-space sphere against the frustum
+//----------------------------------------------------------
+static int isModelSphereVisible(MATRIX *matrix, long x, long y, long z, long radius) {
+    VECTOR in;
+    VECTOR out;
+    
+    in.vx = x;
+    in.vy = y;
+    in.vz = z;
+    ApplyMatrixLV(matrix, &in, &out);
+    
+    grid_cells_tested++;
+    return isSphereVisible(out.vx + matrix->t[0], out.vy + matrix->t[1], out.vz + matrix->t[2], radius);
+}
+
+//----------------------------------------------------------
+// Visit a rectangle of cells, splitting it while it is partly visible
+//----------------------------------------------------------
+static void visitCells(GridDraw *draw, int x0, int z0, int x1, int z1) {
+    ModelGrid *grid = draw->grid;
+    MATRIX *matrix = draw->matrix;
+    long half_x = ((x1 - x0) * grid->cell_size >> 1) + grid->margin;
+    long half_z = ((z1 - z0) * grid->cell_size >> 1) + grid->margin;
+    long half_y = (grid->max_y - grid->min_y) >> 1;
+    long cx = grid->origin_x + ((x0 + x1) * grid->cell_size >> 1);
+    long cz = grid->origin_z + ((z0 + z1) * grid->cell_size >> 1);
+    long cy = (grid->min_y + grid->max_y) >> 1;
+    
+    if (x1 - x0 == 1 && z1 - z0 == 1) {
+        // Single cell: use its exported bounds
+        int cell = z0 * grid->width + x0;
+        long *b = grid->bounds[cell];
+        
+        if (grid->tri_ranges[cell][1] == 0 && grid->quad_ranges[cell][1] == 0) {
+            return;
+        }
+        if (isModelSphereVisible(matrix, b[0], b[1], b[2], b[3])) {
+            // List full: draw what was collected so no visible cell is dropped
+            if (visible_count == GRID_MAX_VISIBLE) {
+                flushVisibleCells(draw);
+            }
+            visible_cells[visible_count++] = cell;
+        }
+        return;
+    }
+    
+    if (!isModelSphereVisible(matrix, cx, cy, cz, boundLength3(half_x, half_y, half_z))) {
+        return;
+    }
+    
+    // Split along the longer side
+    if (x1 - x0 >= z1 - z0) {
+        int mid = (x0 + x1) >> 1;
+        visitCells(draw, x0, z0, mid, z1);
+        visitCells(draw, mid, z0, x1, z1);
+    } else {
+        int mid = (z0 + z1) >> 1;
+        visitCells(draw, x0, z0, x1, mid);
+        visitCells(draw, x0, mid, x1, z1);
+    }
+}
+
+char* renderModelGrid(
+    SVECTOR *verts,
+    ModelData *model,
+    ModelGrid *grid,
+    MATRIX *matrix,
+    char *nextpri,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+) {
+    GridDraw draw;
+    
+    draw.verts = verts;
+    draw.model = model;
+    draw.grid = grid;
+    draw.matrix = matrix;
+    draw.nextpri = setModelCutout(model, nextpri, ot, ot_length);
+    draw.ot = ot;
+    draw.ot_length = ot_length;
+    draw.tpage = tpage;
+    draw.clut = clut;
+    
+    grid_cells_tested = 0;
+    grid_cells_drawn = 0;
+    grid_batches = 0;
+    visible_count = 0;
+    visitCells(&draw, 0, 0, grid->width, grid->depth);
+    flushVisibleCells(&draw);
+    
+    return draw.nextpri;
+}
@@ -0,0 +1,48 @@
+/*
+ * Uniform grid partition for static level geometry
+ */
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <sys/types.h>
+#include <libgte.h>
+#include "model.h"
+
+// Grid over the X/Z plane (matches the exporter's spatial grid output)
+// Faces are ordered by cell, cell = z * width + x
+typedef struct {
+    int width;                          // Cells along X
+    int depth;                          // Cells along Z
+    long cell_size;                     // Cell edge length (PS1 units)
+    long origin_x;                      // Model position of cell (0, 0)'s corner
+    long origin_z;
+    long min_y;                         // Vertical extent of all geometry
+    long max_y;
+    long margin;                        // How far faces overhang their cell
+    unsigned short (*tri_ranges)[2];    // Per-cell { start, count }
+    unsigned short (*quad_ranges)[2];
+    long (*bounds)[4];                  // Per-cell { cx, cy, cz, radius }
+} ModelGrid;
+
+// Cells tested / drawn by the last renderModelGrid call
+extern int grid_cells_tested;
+extern int grid_cells_drawn;
+extern int grid_batches;        // > 1 when more cells were visible than one list holds
+
+// Render only the cells whose bounds intersect the view frustum
+// matrix is the composed view * world matrix of the model
+// Returns updated nextpri pointer
+char* renderModelGrid(
+    SVECTOR *verts,
+    ModelData *model,
+    ModelGrid *grid,
+    MATRIX *matrix,
+    char *nextpri,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+);
+
+#endif // GRID_H
@@ -1,6 +1,5 @@
 #include "input.h"
 #include "camera.h"
-#include "animation.h"
 
 // Controller state
 u_long padState = 0;
@@ -16,13 +15,6 @@ void handleInput(void) {
     padStateOld = padState;
     padState = PadRead(0);  // Read pad 0 (first controller)
     
-    // Triangle button to switch animation
-    if ((padState & PADRup) && !(padStateOld & PADRup)) {
-        current_anim = !current_anim;
-        current_frame = 0;
-        frame_timer = 0;
-    }
-    
     // D-pad left/right to orbit camera
     if (padState & PADLleft) {
         camera_rotation.vy += 32;
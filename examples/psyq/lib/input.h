@@ -11,7 +11,7 @@ extern u_long padStateOld;
 // Initialize controller
 void initController(void);
 
-// Handle input (updates camera and animation)
+// Handle input (updates camera)
 void handleInput(void);
 
 #endif // INPUT_H
@@ -3,6 +3,8 @@
  */
 
 #include "model.h"
+#include "ordering.h"
+#include "camera.h"
 #include <stdlib.h>
 
 // Material flag bit definitions
@@ -15,8 +17,37 @@
 #define MAT_FLAG_SPECULAR     (1 << 6)
 #define MAT_FLAG_METALLIC     (1 << 7)
 
-// OTZ shift for extended draw distance (shift right by 2 = 4x range)
-#define OTZ_SHIFT 2
+// Current OTZ mapping applied before OT insertion (see setModelOTZShift)
+// OT index = (otz - otz_bias) >> otz_shift
+static int otz_shift = OTZ_SHIFT;
+static long otz_bias = 0;
+
+void setModelOTZShift(int shift) {
+    otz_shift = shift;
+}
+
+int getModelOTZShift(void) {
+    return otz_shift;
+}
+
+void setModelOTZBias(long bias) {
+    otz_bias = bias;
+}
+
+long getModelOTZBias(void) {
+    return otz_bias;
+}
+
+//----------------------------------------------------------
+// Map a RotAverage depth to an OT index
+//----------------------------------------------------------
+static long getOTIndex(long otz, u_long *ot, int ot_length) {
+    long index = (otz - otz_bias) >> otz_shift;
+#ifdef OT_STATS
+    recordOTStats(otz, index, ot, ot_length);
+#endif
+    return index;
+}
 
 //----------------------------------------------------------
 // Check if model has any faces with cutout transparency
@@ -101,6 +132,8 @@ static void applyMetallic(CVECTOR *color, SVECTOR *normal, unsigned char metalli
 static char* renderTriangles(
     SVECTOR *verts,
     ModelData *model,
+    int start,
+    int count,
     char *nextpri,
     u_long *ot,
     int ot_length,
@@ -108,17 +141,10 @@ static char* renderTriangles(
     u_short clut
 ) {
     int i;
+    int end = start + count;
     long otz, p, flg;
     
-    for (i = 0; i < model->tri_count; i++) {
-        // Check mesh visibility
-        if (model->mesh_ids) {
-            unsigned char mesh_id = model->mesh_ids[i];
-            if (!(model->visible_meshes & (1 << mesh_id))) {
-                continue;  // Skip this face
-            }
-        }
-        
+    for (i = start; i < end; i++) {
         unsigned char flags = model->material_flags[i];
         int v0 = model->tri_faces[i][0];
         int v1 = model->tri_faces[i][1];
@@ -142,7 +168,7 @@ static char* renderTriangles(
                     (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     int uv0 = model->tri_uvs[i][0];
@@ -218,7 +244,7 @@ static char* renderTriangles(
                     (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     int uv0 = model->tri_uvs[i][0];
@@ -280,7 +306,7 @@ static char* renderTriangles(
                     (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     // Apply lighting or set vertex colors
@@ -342,7 +368,7 @@ static char* renderTriangles(
                     (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     // Apply lighting or set color
@@ -392,6 +418,8 @@ static char* renderTriangles(
 static char* renderQuads(
     SVECTOR *verts,
     ModelData *model,
+    int start,
+    int count,
     char *nextpri,
     u_long *ot,
     int ot_length,
@@ -399,18 +427,11 @@ static char* renderQuads(
     u_short clut
 ) {
     int i;
+    int end = start + count;
     long otz, p, flg;
-    int face_index = model->tri_count;  // Quads start after triangles in material_flags
+    int face_index = model->tri_count + start;  // Quads start after triangles in material_flags
     
-    for (i = 0; i < model->quad_count; i++, face_index++) {
-        // Check mesh visibility
-        if (model->mesh_ids) {
-            unsigned char mesh_id = model->mesh_ids[face_index];
-            if (!(model->visible_meshes & (1 << mesh_id))) {
-                continue;  // Skip this face
-            }
-        }
-        
+    for (i = start; i < end; i++, face_index++) {
         unsigned char flags = model->material_flags[face_index];
         int v0 = model->quad_faces[i][0];
         int v1 = model->quad_faces[i][1];
@@ -436,7 +457,7 @@ static char* renderQuads(
                     (long*)&poly->x2, (long*)&poly->x3,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     int uv0 = model->quad_uvs[i][0];
@@ -522,7 +543,7 @@ static char* renderQuads(
                     (long*)&poly->x2, (long*)&poly->x3,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     int uv0 = model->quad_uvs[i][0];
@@ -587,7 +608,7 @@ static char* renderQuads(
                     (long*)&poly->x2, (long*)&poly->x3,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     // Apply lighting or set vertex colors
@@ -657,7 +678,7 @@ static char* renderQuads(
                     (long*)&poly->x2, (long*)&poly->x3,
                     &p, &flg
                 );
-                otz >>= OTZ_SHIFT;  // Extend draw distance
+                otz = getOTIndex(otz, ot, ot_length);
                 
                 if (otz > 0 && otz < ot_length) {
                     // Apply lighting or set color
@@ -702,9 +723,9 @@ static char* renderQuads(
 }
 
 //----------------------------------------------------------
-// Render the model
+// Mask bit control for cutout transparency
 //----------------------------------------------------------
-char* renderModel(SVECTOR *verts, ModelData *model, char *nextpri, u_long *ot, int ot_length, u_short tpage, u_short clut) {
+char* setModelCutout(ModelData *model, char *nextpri, u_long *ot, int ot_length) {
     // Only set mask bit control if this model has cutout transparency
     if (modelNeedsCutout(model)) {
         // FromSource mode (0): GPU reads bit 15 from texture/CLUT for each pixel
@@ -715,10 +736,721 @@ char* renderModel(SVECTOR *verts, ModelData *model, char *nextpri, u_long *ot, i
         addPrim(&ot[ot_length - 1], stp);
         nextpri += sizeof(DR_STP);
     }
+    return nextpri;
+}
+
+//----------------------------------------------------------
+// Render explicit face ranges
+//----------------------------------------------------------
+char* renderModelFaces(
+    SVECTOR *verts,
+    ModelData *model,
+    int tri_start,
+    int tri_count,
+    int quad_start,
+    int quad_count,
+    char *nextpri,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+) {
+    nextpri = renderTriangles(verts, model, tri_start, tri_count, nextpri, ot, ot_length, tpage, clut);
+    return renderQuads(verts, model, quad_start, quad_count, nextpri, ot, ot_length, tpage, clut);
+}
+
+//----------------------------------------------------------
+// Render the model
+//----------------------------------------------------------
+char* renderModel(SVECTOR *verts, ModelData *model, char *nextpri, u_long *ot, int ot_length, u_short tpage, u_short clut) {
+    nextpri = setModelCutout(model, nextpri, ot, ot_length);
+    
+    if (model->tri_ranges && model->quad_ranges) {
+        // Hidden meshes skip their whole face range (the mask holds MODEL_MAX_MESHES bits)
+        int m;
+        for (m = 0; m < model->mesh_count && m < MODEL_MAX_MESHES; m++) {
+            if (model->visible_meshes & (1UL << m)) {
+                nextpri = renderTriangles(verts, model, model->tri_ranges[m][0], model->tri_ranges[m][1],
+                                          nextpri, ot, ot_length, tpage, clut);
+            }
+        }
+        for (m = 0; m < model->mesh_count && m < MODEL_MAX_MESHES; m++) {
+            if (model->visible_meshes & (1UL << m)) {
+                nextpri = renderQuads(verts, model, model->quad_ranges[m][0], model->quad_ranges[m][1],
+                                      nextpri, ot, ot_length, tpage, clut);
+            }
+        }
+    } else if (model->mesh_ids) {
+        // Older exports without ranges: split faces into runs of one mesh
+        int i, run;
+        for (i = 0; i < model->tri_count; i = run) {
+            unsigned char mesh_id = model->mesh_ids[i];
+            for (run = i + 1; run < model->tri_count && model->mesh_ids[run] == mesh_id; run++);
+            if (mesh_id < MODEL_MAX_MESHES && (model->visible_meshes & (1UL << mesh_id))) {
+                nextpri = renderTriangles(verts, model, i, run - i, nextpri, ot, ot_length, tpage, clut);
+            }
+        }
+        for (i = 0; i < model->quad_count; i = run) {
+            unsigned char mesh_id = model->mesh_ids[model->tri_count + i];
+            for (run = i + 1; run < model->quad_count && model->mesh_ids[model->tri_count + run] == mesh_id; run++);
+            if (mesh_id < MODEL_MAX_MESHES && (model->visible_meshes & (1UL << mesh_id))) {
+                nextpri = renderQuads(verts, model, i, run - i, nextpri, ot, ot_length, tpage, clut);
+            }
+        }
+    } else {
+        // Render all primitives
+        nextpri = renderTriangles(verts, model, 0, model->tri_count, nextpri, ot, ot_length, tpage, clut);
+        nextpri = renderQuads(verts, model, 0, model->quad_count, nextpri, ot, ot_length, tpage, clut);
+    }
+    return nextpri;
+}
+
+//----------------------------------------------------------
+// Persistent primitives
+//----------------------------------------------------------
+
+// Primitive type selector: textured and smooth bits of the material flags
+#define PRIM_TYPE(flags) ((flags) & (MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH))
+
+//----------------------------------------------------------
+// Size of the primitive a face renders as
+//----------------------------------------------------------
+static int primSize(unsigned char flags, int is_quad) {
+    switch (PRIM_TYPE(flags)) {
+        case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH:
+            return is_quad ? sizeof(POLY_GT4) : sizeof(POLY_GT3);
+        case MAT_FLAG_TEXTURED:
+            return is_quad ? sizeof(POLY_FT4) : sizeof(POLY_FT3);
+        case MAT_FLAG_SMOOTH:
+            return is_quad ? sizeof(POLY_G4) : sizeof(POLY_G3);
+        default:
+            return is_quad ? sizeof(POLY_F4) : sizeof(POLY_F3);
+    }
+}
+
+//----------------------------------------------------------
+// Colour of an unlit vertex (baked into the primitive once)
+//----------------------------------------------------------
+static void getUnlitColor(ModelData *model, int v, unsigned char flags, CVECTOR *col) {
+    if (flags & MAT_FLAG_VERTEX_COLOR) {
+        *col = model->vertex_colors[v];
+    } else {
+        col->r = 128;
+        col->g = 128;
+        col->b = 128;
+    }
+}
+
+//----------------------------------------------------------
+// Colour of a lit vertex (recomputed every frame)
+//----------------------------------------------------------
+static void getLitColor(ModelData *model, int v, int face_index, unsigned char flags, CVECTOR *col) {
+    CVECTOR base_color = (flags & MAT_FLAG_VERTEX_COLOR) ? model->vertex_colors[v] : (CVECTOR){128, 128, 128, 0};
+    
+    NormalColorCol(&model->normals[v], &base_color, col);
+    
+    if ((flags & MAT_FLAG_SPECULAR) && model->specular) {
+        applySpecular(col, &model->normals[v], model->specular[face_index]);
+    }
+    if ((flags & MAT_FLAG_METALLIC) && model->metallic) {
+        applyMetallic(col, &model->normals[v], model->metallic[face_index]);
+    }
+}
+
+//----------------------------------------------------------
+// Write tpage/clut into a textured primitive
+//----------------------------------------------------------
+static void setPrimTexture(char *prim, unsigned char flags, int is_quad, u_short tpage, u_short clut) {
+    switch (PRIM_TYPE(flags)) {
+        case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH:
+            if (is_quad) {
+                ((POLY_GT4 *)prim)->tpage = tpage;
+                ((POLY_GT4 *)prim)->clut = clut;
+            } else {
+                ((POLY_GT3 *)prim)->tpage = tpage;
+                ((POLY_GT3 *)prim)->clut = clut;
+            }
+            break;
+        case MAT_FLAG_TEXTURED:
+            if (is_quad) {
+                ((POLY_FT4 *)prim)->tpage = tpage;
+                ((POLY_FT4 *)prim)->clut = clut;
+            } else {
+                ((POLY_FT3 *)prim)->tpage = tpage;
+                ((POLY_FT3 *)prim)->clut = clut;
+            }
+            break;
+    }
+}
+
+//----------------------------------------------------------
+// Build a triangle primitive from model data (no exported template)
+//----------------------------------------------------------
+static void initTrianglePrim(ModelData *model, int i, char *prim) {
+    unsigned char flags = model->material_flags[i];
+    int v0 = model->tri_faces[i][0];
+    int v1 = model->tri_faces[i][1];
+    int v2 = model->tri_faces[i][2];
+    CVECTOR col0, col1, col2;
+    
+    // Lit faces get their colours every frame; this only matters for unlit ones
+    getUnlitColor(model, v0, flags, &col0);
+    getUnlitColor(model, v1, flags, &col1);
+    getUnlitColor(model, v2, flags, &col2);
+    
+    switch (PRIM_TYPE(flags)) {
+        case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH: {
+            POLY_GT3 *poly = (POLY_GT3 *)prim;
+            int uv0 = model->tri_uvs[i][0];
+            int uv1 = model->tri_uvs[i][1];
+            int uv2 = model->tri_uvs[i][2];
+            setPolyGT3(poly);
+            setUV3(poly,
+                model->uvs[uv0].vx, model->uvs[uv0].vy,
+                model->uvs[uv1].vx, model->uvs[uv1].vy,
+                model->uvs[uv2].vx, model->uvs[uv2].vy
+            );
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            setRGB1(poly, col1.r, col1.g, col1.b);
+            setRGB2(poly, col2.r, col2.g, col2.b);
+            break;
+        }
+        case MAT_FLAG_TEXTURED: {
+            POLY_FT3 *poly = (POLY_FT3 *)prim;
+            int uv0 = model->tri_uvs[i][0];
+            int uv1 = model->tri_uvs[i][1];
+            int uv2 = model->tri_uvs[i][2];
+            setPolyFT3(poly);
+            setUV3(poly,
+                model->uvs[uv0].vx, model->uvs[uv0].vy,
+                model->uvs[uv1].vx, model->uvs[uv1].vy,
+                model->uvs[uv2].vx, model->uvs[uv2].vy
+            );
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            break;
+        }
+        case MAT_FLAG_SMOOTH: {
+            POLY_G3 *poly = (POLY_G3 *)prim;
+            setPolyG3(poly);
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            setRGB1(poly, col1.r, col1.g, col1.b);
+            setRGB2(poly, col2.r, col2.g, col2.b);
+            break;
+        }
+        default: {
+            POLY_F3 *poly = (POLY_F3 *)prim;
+            setPolyF3(poly);
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            break;
+        }
+    }
+    
+    if (flags & MAT_FLAG_ALPHA) {
+        setSemiTrans(prim, 1);
+    }
+}
+
+//----------------------------------------------------------
+// Build a quad primitive from model data (no exported template)
+//----------------------------------------------------------
+static void initQuadPrim(ModelData *model, int i, char *prim) {
+    int face_index = model->tri_count + i;
+    unsigned char flags = model->material_flags[face_index];
+    int v0 = model->quad_faces[i][0];
+    int v1 = model->quad_faces[i][1];
+    int v2 = model->quad_faces[i][2];
+    int v3 = model->quad_faces[i][3];
+    CVECTOR col0, col1, col2, col3;
+    
+    // Lit faces get their colours every frame; this only matters for unlit ones
+    getUnlitColor(model, v0, flags, &col0);
+    getUnlitColor(model, v1, flags, &col1);
+    getUnlitColor(model, v2, flags, &col2);
+    getUnlitColor(model, v3, flags, &col3);
+    
+    switch (PRIM_TYPE(flags)) {
+        case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH: {
+            POLY_GT4 *poly = (POLY_GT4 *)prim;
+            int uv0 = model->quad_uvs[i][0];
+            int uv1 = model->quad_uvs[i][1];
+            int uv2 = model->quad_uvs[i][2];
+            int uv3 = model->quad_uvs[i][3];
+            setPolyGT4(poly);
+            setUV4(poly,
+                model->uvs[uv0].vx, model->uvs[uv0].vy,
+                model->uvs[uv1].vx, model->uvs[uv1].vy,
+                model->uvs[uv2].vx, model->uvs[uv2].vy,
+                model->uvs[uv3].vx, model->uvs[uv3].vy
+            );
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            setRGB1(poly, col1.r, col1.g, col1.b);
+            setRGB2(poly, col2.r, col2.g, col2.b);
+            setRGB3(poly, col3.r, col3.g, col3.b);
+            break;
+        }
+        case MAT_FLAG_TEXTURED: {
+            POLY_FT4 *poly = (POLY_FT4 *)prim;
+            int uv0 = model->quad_uvs[i][0];
+            int uv1 = model->quad_uvs[i][1];
+            int uv2 = model->quad_uvs[i][2];
+            int uv3 = model->quad_uvs[i][3];
+            setPolyFT4(poly);
+            setUV4(poly,
+                model->uvs[uv0].vx, model->uvs[uv0].vy,
+                model->uvs[uv1].vx, model->uvs[uv1].vy,
+                model->uvs[uv2].vx, model->uvs[uv2].vy,
+                model->uvs[uv3].vx, model->uvs[uv3].vy
+            );
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            break;
+        }
+        case MAT_FLAG_SMOOTH: {
+            POLY_G4 *poly = (POLY_G4 *)prim;
+            setPolyG4(poly);
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            setRGB1(poly, col1.r, col1.g, col1.b);
+            setRGB2(poly, col2.r, col2.g, col2.b);
+            setRGB3(poly, col3.r, col3.g, col3.b);
+            break;
+        }
+        default: {
+            POLY_F4 *poly = (POLY_F4 *)prim;
+            setPolyF4(poly);
+            setRGB0(poly, col0.r, col0.g, col0.b);
+            break;
+        }
+    }
+    
+    if (flags & MAT_FLAG_ALPHA) {
+        setSemiTrans(prim, 1);
+    }
+}
+
+u_long getModelPrimsSize(ModelData *model) {
+    u_long size = 0;
+    int i;
+    
+    for (i = 0; i < model->tri_count; i++) {
+        size += primSize(model->material_flags[i], 0);
+    }
+    for (i = 0; i < model->quad_count; i++) {
+        size += primSize(model->material_flags[model->tri_count + i], 1);
+    }
+    return size;
+}
+
+//----------------------------------------------------------
+// Per-mesh ranges are only used when every mesh fits the offset tables;
+// anything larger falls back to drawing the whole model as one range
+//----------------------------------------------------------
+static int hasPrimRanges(ModelData *model) {
+    return model->tri_ranges && model->quad_ranges && model->mesh_count <= MODEL_MAX_MESHES;
+}
+
+//----------------------------------------------------------
+// Byte offset of each mesh's first tri and quad in a primitive copy,
+// so hidden ranges are skipped
+//----------------------------------------------------------
+static void initModelPrimOffsets(ModelPrims *prims, ModelData *model) {
+    u_long offset = 0;
+    int face = 0;
+    int m;
+    
+    prims->model = model;
+    
+    if (hasPrimRanges(model)) {
+        for (m = 0; m < model->mesh_count; m++) {
+            for (; face < model->tri_ranges[m][0]; face++) {
+                offset += primSize(model->material_flags[face], 0);
+            }
+            prims->tri_offset[m] = offset;
+        }
+        for (; face < model->tri_count; face++) {
+            offset += primSize(model->material_flags[face], 0);
+        }
+        face = 0;
+        for (m = 0; m < model->mesh_count; m++) {
+            for (; face < model->quad_ranges[m][0]; face++) {
+                offset += primSize(model->material_flags[model->tri_count + face], 1);
+            }
+            prims->quad_offset[m] = offset;
+        }
+    } else {
+        prims->tri_offset[0] = 0;
+        for (face = 0; face < model->tri_count; face++) {
+            offset += primSize(model->material_flags[face], 0);
+        }
+        prims->quad_offset[0] = offset;
+    }
+}
+
+//----------------------------------------------------------
+// Fill one copy of a model's primitives; only XY and lit colours are
+// left for the per-frame patch
+//----------------------------------------------------------
+static void fillModelPrims(ModelData *model, char *prim, u_long size, u_short tpage, u_short clut) {
+    int i;
+    
+    if (model->prim_templates) {
+        u_long *src = model->prim_templates;
+        u_long *dst = (u_long *)prim;
+        u_long words = size >> 2;
+        while (words--) {
+            *dst++ = *src++;
+        }
+    }
+    
+    for (i = 0; i < model->tri_count; i++) {
+        unsigned char flags = model->material_flags[i];
+        if (!model->prim_templates) {
+            initTrianglePrim(model, i, prim);
+        }
+        setPrimTexture(prim, flags, 0, tpage, clut);
+        prim += primSize(flags, 0);
+    }
+    for (i = 0; i < model->quad_count; i++) {
+        unsigned char flags = model->material_flags[model->tri_count + i];
+        if (!model->prim_templates) {
+            initQuadPrim(model, i, prim);
+        }
+        setPrimTexture(prim, flags, 1, tpage, clut);
+        prim += primSize(flags, 1);
+    }
+}
+
+void initModelPrims(ModelPrims *prims, ModelData *model, char *buf0, char *buf1, u_short tpage, u_short clut) {
+    u_long size = getModelPrimsSize(model);
+    
+    initModelPrimOffsets(prims, model);
+    prims->prims[0] = buf0;
+    prims->prims[1] = buf1;
+    
+    // Fill both copies once; only XY and lit colours change per frame
+    fillModelPrims(model, buf0, size, tpage, clut);
+    fillModelPrims(model, buf1, size, tpage, clut);
+}
+
+//----------------------------------------------------------
+// Patch and link persistent triangle primitives
+//----------------------------------------------------------
+static void renderTrianglePrims(
+    SVECTOR *verts,
+    ModelData *model,
+    int start,
+    int count,
+    char *prim,
+    u_long *ot,
+    int ot_length
+) {
+    int i;
+    int end = start + count;
+    long otz, p, flg;
+    CVECTOR col0, col1, col2;
+    
+    for (i = start; i < end; i++) {
+        unsigned char flags = model->material_flags[i];
+        int v0 = model->tri_faces[i][0];
+        int v1 = model->tri_faces[i][1];
+        int v2 = model->tri_faces[i][2];
+        int is_lit = !(flags & MAT_FLAG_UNLIT);
+        
+        switch (PRIM_TYPE(flags)) {
+            case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH: {
+                POLY_GT3 *poly = (POLY_GT3 *)prim;
+                otz = RotAverage3(
+                    &verts[v0], &verts[v1], &verts[v2],
+                    (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, i, flags, &col0);
+                        getLitColor(model, v1, i, flags, &col1);
+                        getLitColor(model, v2, i, flags, &col2);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                        setRGB1(poly, col1.r, col1.g, col1.b);
+                        setRGB2(poly, col2.r, col2.g, col2.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_GT3);
+                break;
+            }
+            case MAT_FLAG_TEXTURED: {
+                POLY_FT3 *poly = (POLY_FT3 *)prim;
+                otz = RotAverage3(
+                    &verts[v0], &verts[v1], &verts[v2],
+                    (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, i, flags, &col0);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_FT3);
+                break;
+            }
+            case MAT_FLAG_SMOOTH: {
+                POLY_G3 *poly = (POLY_G3 *)prim;
+                otz = RotAverage3(
+                    &verts[v0], &verts[v1], &verts[v2],
+                    (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, i, flags, &col0);
+                        getLitColor(model, v1, i, flags, &col1);
+                        getLitColor(model, v2, i, flags, &col2);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                        setRGB1(poly, col1.r, col1.g, col1.b);
+                        setRGB2(poly, col2.r, col2.g, col2.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_G3);
+                break;
+            }
+            default: {
+                POLY_F3 *poly = (POLY_F3 *)prim;
+                otz = RotAverage3(
+                    &verts[v0], &verts[v1], &verts[v2],
+                    (long*)&poly->x0, (long*)&poly->x1, (long*)&poly->x2,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, i, flags, &col0);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_F3);
+                break;
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Patch and link persistent quad primitives
+//----------------------------------------------------------
+static void renderQuadPrims(
+    SVECTOR *verts,
+    ModelData *model,
+    int start,
+    int count,
+    char *prim,
+    u_long *ot,
+    int ot_length
+) {
+    int i;
+    int end = start + count;
+    long otz, p, flg;
+    int face_index = model->tri_count + start;  // Quads start after triangles in material_flags
+    CVECTOR col0, col1, col2, col3;
     
-    // Render all primitives
-    nextpri = renderTriangles(verts, model, nextpri, ot, ot_length, tpage, clut);
-    nextpri = renderQuads(verts, model, nextpri, ot, ot_length, tpage, clut);
+    for (i = start; i < end; i++, face_index++) {
+        unsigned char flags = model->material_flags[face_index];
+        int v0 = model->quad_faces[i][0];
+        int v1 = model->quad_faces[i][1];
+        int v2 = model->quad_faces[i][2];
+        int v3 = model->quad_faces[i][3];
+        int is_lit = !(flags & MAT_FLAG_UNLIT);
+        
+        switch (PRIM_TYPE(flags)) {
+            case MAT_FLAG_TEXTURED | MAT_FLAG_SMOOTH: {
+                POLY_GT4 *poly = (POLY_GT4 *)prim;
+                otz = RotAverage4(
+                    &verts[v0], &verts[v1], &verts[v2], &verts[v3],
+                    (long*)&poly->x0, (long*)&poly->x1,
+                    (long*)&poly->x2, (long*)&poly->x3,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, face_index, flags, &col0);
+                        getLitColor(model, v1, face_index, flags, &col1);
+                        getLitColor(model, v2, face_index, flags, &col2);
+                        getLitColor(model, v3, face_index, flags, &col3);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                        setRGB1(poly, col1.r, col1.g, col1.b);
+                        setRGB2(poly, col2.r, col2.g, col2.b);
+                        setRGB3(poly, col3.r, col3.g, col3.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_GT4);
+                break;
+            }
+            case MAT_FLAG_TEXTURED: {
+                POLY_FT4 *poly = (POLY_FT4 *)prim;
+                otz = RotAverage4(
+                    &verts[v0], &verts[v1], &verts[v2], &verts[v3],
+                    (long*)&poly->x0, (long*)&poly->x1,
+                    (long*)&poly->x2, (long*)&poly->x3,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, face_index, flags, &col0);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_FT4);
+                break;
+            }
+            case MAT_FLAG_SMOOTH: {
+                POLY_G4 *poly = (POLY_G4 *)prim;
+                otz = RotAverage4(
+                    &verts[v0], &verts[v1], &verts[v2], &verts[v3],
+                    (long*)&poly->x0, (long*)&poly->x1,
+                    (long*)&poly->x2, (long*)&poly->x3,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, face_index, flags, &col0);
+                        getLitColor(model, v1, face_index, flags, &col1);
+                        getLitColor(model, v2, face_index, flags, &col2);
+                        getLitColor(model, v3, face_index, flags, &col3);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                        setRGB1(poly, col1.r, col1.g, col1.b);
+                        setRGB2(poly, col2.r, col2.g, col2.b);
+                        setRGB3(poly, col3.r, col3.g, col3.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_G4);
+                break;
+            }
+            default: {
+                POLY_F4 *poly = (POLY_F4 *)prim;
+                otz = RotAverage4(
+                    &verts[v0], &verts[v1], &verts[v2], &verts[v3],
+                    (long*)&poly->x0, (long*)&poly->x1,
+                    (long*)&poly->x2, (long*)&poly->x3,
+                    &p, &flg
+                );
+                otz = getOTIndex(otz, ot, ot_length);
+                if (otz > 0 && otz < ot_length) {
+                    if (is_lit) {
+                        getLitColor(model, v0, face_index, flags, &col0);
+                        setRGB0(poly, col0.r, col0.g, col0.b);
+                    }
+                    addPrim(&ot[otz], poly);
+                }
+                prim += sizeof(POLY_F4);
+                break;
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Patch and link every visible face of one primitive copy
+// visible_meshes is passed in so instances can differ from the model
+//----------------------------------------------------------
+static void patchModelPrims(SVECTOR *verts, ModelPrims *prims, char *base, u_long visible_meshes, u_long *ot, int ot_length) {
+    ModelData *model = prims->model;
+    
+    if (hasPrimRanges(model)) {
+        // Hidden meshes skip their whole face range
+        int m;
+        for (m = 0; m < model->mesh_count; m++) {
+            if (visible_meshes & (1UL << m)) {
+                renderTrianglePrims(verts, model, model->tri_ranges[m][0], model->tri_ranges[m][1],
+                                    base + prims->tri_offset[m], ot, ot_length);
+                renderQuadPrims(verts, model, model->quad_ranges[m][0], model->quad_ranges[m][1],
+                                base + prims->quad_offset[m], ot, ot_length);
+            }
+        }
+    } else {
+        renderTrianglePrims(verts, model, 0, model->tri_count, base + prims->tri_offset[0], ot, ot_length);
+        renderQuadPrims(verts, model, 0, model->quad_count, base + prims->quad_offset[0], ot, ot_length);
+    }
+}
+
+//----------------------------------------------------------
+// Render the model from its persistent primitives
+//----------------------------------------------------------
+char* renderModelPrims(SVECTOR *verts, ModelPrims *prims, int buffer, char *nextpri, u_long *ot, int ot_length) {
+    nextpri = setModelCutout(prims->model, nextpri, ot, ot_length);
+    
+    patchModelPrims(verts, prims, prims->prims[buffer], prims->model->visible_meshes, ot, ot_length);
     return nextpri;
 }
 
+//----------------------------------------------------------
+// Instanced rendering
+//----------------------------------------------------------
+char* renderModelInstances(
+    SVECTOR *verts,
+    ModelData *model,
+    MATRIX *matrices,
+    const long *radii,
+    int count,
+    u_long visible_meshes,
+    char *nextpri,
+    char *end,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+) {
+    ModelPrims layout;
+    u_long size = getModelPrimsSize(model);
+    char *template_prims = NULL;
+    int i;
+    
+    initModelPrimOffsets(&layout, model);
+    
+    if ((u_long)(end - nextpri) < sizeof(DR_STP) + size) {
+        return nextpri;  // Not even one copy fits
+    }
+    nextpri = setModelCutout(model, nextpri, ot, ot_length);
+    
+    for (i = 0; i < count; i++) {
+        MATRIX *matrix = &matrices[i];
+        
+        if (radii && !isSphereVisible(matrix->t[0], matrix->t[1], matrix->t[2], radii[i])) {
+            continue;
+        }
+        
+        // Primitive buffer full: drop the rest of the batch rather than overrun it
+        if ((u_long)(end - nextpri) < size) {
+            break;
+        }
+        
+        // First visible instance builds the primitives; the rest copy them
+        if (!template_prims) {
+            fillModelPrims(model, nextpri, size, tpage, clut);
+            template_prims = nextpri;
+        } else {
+            u_long *src = (u_long *)template_prims;
+            u_long *dst = (u_long *)nextpri;
+            u_long words = size >> 2;
+            while (words--) {
+                *dst++ = *src++;
+            }
+        }
+        
+        SetRotMatrix(matrix);
+        SetTransMatrix(matrix);
+        patchModelPrims(verts, &layout, nextpri, visible_meshes, ot, ot_length);
+        nextpri += size;
+    }
+    
+    return nextpri;
+}
@@ -9,6 +9,11 @@
 #include <libgte.h>
 #include <libgpu.h>
 
+// Default OTZ shift for extended draw distance (shift right by 2 = 4x range)
+#ifndef OTZ_SHIFT
+#define OTZ_SHIFT 2
+#endif
+
 // Model data structure to pass to renderer
 typedef struct {
     int tri_count;
@@ -25,8 +30,28 @@ typedef struct {
     unsigned char *metallic;  // Metallic values (0-255)
     unsigned char *mesh_ids;  // Mesh ID per face (for visibility control)
     unsigned int visible_meshes;  // Bitmask: bit N = mesh N visible
+    int mesh_count;  // Number of sub-meshes described by the ranges below
+    unsigned short (*tri_ranges)[2];   // Per-mesh { start, count } into tri arrays (NULL = none)
+    unsigned short (*quad_ranges)[2];  // Per-mesh { start, count } into quad arrays (NULL = none)
+    u_long *prim_templates;  // Exported GPU packet per face (NULL = build at init)
 } ModelData;
 
+// Maximum sub-meshes (visible_meshes is a 32-bit mask)
+#define MODEL_MAX_MESHES 32
+
+// Worst-case persistent primitive buffer size (every face a POLY_GT4)
+#define MODEL_PRIM_BUFFER_MAX(faces) ((faces) * sizeof(POLY_GT4))
+
+// Persistent primitives for a model, one copy per display buffer.
+// UVs, tpage, clut, semi-transparency and unlit colours are written once
+// at init; each frame only XY (and lit colours) are patched before linking.
+typedef struct {
+    ModelData *model;
+    char *prims[2];                        // Primitive copies, one per display buffer
+    u_long tri_offset[MODEL_MAX_MESHES];   // Byte offset of each mesh's first tri
+    u_long quad_offset[MODEL_MAX_MESHES];  // Byte offset of each mesh's first quad
+} ModelPrims;
+
 // Render the complete model with given vertices
 // Returns updated nextpri pointer
 char* renderModel(
@@ -39,4 +64,77 @@ char* renderModel(
     u_short clut
 );
 
+// Add the mask bit control primitive if the model has cutout faces
+// (renderModel does this itself). Returns updated nextpri pointer
+char* setModelCutout(ModelData *model, char *nextpri, u_long *ot, int ot_length);
+
+// Render explicit tri and quad ranges, ignoring mesh visibility and
+// without the cutout primitive. Returns updated nextpri pointer
+char* renderModelFaces(
+    SVECTOR *verts,
+    ModelData *model,
+    int tri_start,
+    int tri_count,
+    int quad_start,
+    int quad_count,
+    char *nextpri,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+);
+
+// Set the right shift applied to RotAverage depths before OT insertion
+// Larger shifts cover more depth with fewer OT entries (default OTZ_SHIFT)
+void setModelOTZShift(int shift);
+int getModelOTZShift(void);
+
+// Set the depth subtracted before the shift (0 for the frame OT)
+// Used to render into small OTs that cover only one object's depth range
+void setModelOTZBias(long bias);
+long getModelOTZBias(void);
+
+// Get the bytes needed for one copy of a model's persistent primitives
+u_long getModelPrimsSize(ModelData *model);
+
+// Initialize persistent primitives from the exported templates (or build
+// them from the model data when it has none). buf0/buf1 must each hold
+// getModelPrimsSize(model) bytes.
+void initModelPrims(ModelPrims *prims, ModelData *model, char *buf0, char *buf1, u_short tpage, u_short clut);
+
+// Render a model from its persistent primitives for display buffer 'buffer'
+// Returns updated nextpri pointer (only used for the cutout DR_STP)
+char* renderModelPrims(
+    SVECTOR *verts,
+    ModelPrims *prims,
+    int buffer,
+    char *nextpri,
+    u_long *ot,
+    int ot_length
+);
+
+// Render one model at many placements (composed view * world matrices)
+// Primitives are built once for the first visible instance and copied for
+// the rest, so only projection and lit colours are per instance. Instances
+// whose bounding sphere (radii[i] around the origin, already scaled by the
+// instance's largest scale) is outside the view are skipped; pass NULL
+// radii when the caller has already culled the batch.
+// visible_meshes replaces model->visible_meshes for the batch, leaving the
+// shared model untouched. Instances stop once the next copy would pass
+// 'end' (the end of the primitive buffer). Returns updated nextpri pointer
+char* renderModelInstances(
+    SVECTOR *verts,
+    ModelData *model,
+    MATRIX *matrices,
+    const long *radii,
+    int count,
+    u_long visible_meshes,
+    char *nextpri,
+    char *end,
+    u_long *ot,
+    int ot_length,
+    u_short tpage,
+    u_short clut
+);
+
 #endif
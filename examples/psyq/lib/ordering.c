@@ -0,0 +1,176 @@
+/*
+ * Per-object local ordering tables implementation
+ */
+
+#include "ordering.h"
+#include "model.h"
+
+// Set while a LocalOT is being filled
+static int ot_stats_local = 0;
+
+long getVertsBoundRadius(SVECTOR *verts, int count) {
+    long extent = 0;
+    int i;
+    
+    for (i = 0; i < count; i++) {
+        long x = verts[i].vx < 0 ? -verts[i].vx : verts[i].vx;
+        long y = verts[i].vy < 0 ? -verts[i].vy : verts[i].vy;
+        long z = verts[i].vz < 0 ? -verts[i].vz : verts[i].vz;
+        
+        if (x > extent) extent = x;
+        if (y > extent) extent = y;
+        if (z > extent) extent = z;
+    }
+    
+    // Largest component * 7/4 bounds the length (sqrt(3) < 1.75)
+    return (extent * 7) >> 2;
+}
+
+void initLocalOT(LocalOT *lot, long radius) {
+    lot->radius = radius;
+    lot->z = -1;
+    lot->saved_shift = OTZ_SHIFT;
+    lot->saved_bias = 0;
+}
+
+u_long* beginLocalOT(LocalOT *lot, int buffer, MATRIX *matrix) {
+    u_long *local_ot = lot->ot[buffer];
+    // RotAverage depths are SZ / 4
+    long near_z = (matrix->t[2] - lot->radius) >> 2;
+    long span = (lot->radius * 2) >> 2;
+    int shift = 0;
+    
+    // Fit the object's depth span into the local table
+    while ((span >> shift) >= LOCAL_OT_LENGTH - 1) {
+        shift++;
+    }
+    
+    lot->saved_shift = getModelOTZShift();
+    lot->saved_bias = getModelOTZBias();
+    
+    // Nearest face lands on entry 1 (entry 0 is rejected by the renderers)
+    setModelOTZShift(shift);
+    setModelOTZBias(near_z - (1 << shift));
+    
+    ClearOTagR(local_ot, LOCAL_OT_LENGTH);
+    ot_stats_local = 1;
+    return local_ot;
+}
+
+void endLocalOT(LocalOT *lot, int buffer, MATRIX *matrix, u_long *ot, int ot_length) {
+    u_long *local_ot = lot->ot[buffer];
+    long z;
+    
+    setModelOTZShift(lot->saved_shift);
+    setModelOTZBias(lot->saved_bias);
+    ot_stats_local = 0;
+    
+    // Frame OT entry of the object's origin
+    z = ((matrix->t[2] >> 2) - lot->saved_bias) >> lot->saved_shift;
+    if (z <= 0 || z >= ot_length) {
+        lot->z = -1;
+        return;
+    }
+    
+    AddPrims(&ot[z], &local_ot[LOCAL_OT_LENGTH - 1], &local_ot[0]);
+    lot->z = z;
+}
+
+//----------------------------------------------------------
+// OT statistics and tuning
+//----------------------------------------------------------
+OTStats ot_stats;
+
+// Deepest raw depth seen since the last reset (tuning input)
+static long ot_peak_otz = 0;
+static int ot_tune_settled = 0;
+
+void beginOTStatsFrame(void) {
+    int i;
+    
+    for (i = 0; i < OT_STATS_BINS; i++) {
+        ot_stats.histogram[i] = 0;
+    }
+    ot_stats.inserted = 0;
+    ot_stats.rejected_near = 0;
+    ot_stats.rejected_far = 0;
+    ot_stats.rejected_local = 0;
+    ot_stats.collisions = 0;
+    ot_stats.min_otz = 0x7FFFFFFF;
+    ot_stats.max_otz = 0;
+}
+
+void recordOTStats(long otz, long index, u_long *ot, int ot_length) {
+    int bin = otz >> OT_STATS_BIN_SHIFT;
+    
+    if (ot_stats_local && (index <= 0 || index >= ot_length)) {
+        ot_stats.rejected_local++;
+        return;
+    }
+    if (index <= 0) {
+        ot_stats.rejected_near++;
+        return;
+    }
+    if (index >= ot_length) {
+        ot_stats.rejected_far++;
+        if (otz > ot_peak_otz) {
+            ot_peak_otz = otz;
+        }
+        return;
+    }
+    
+    if (bin >= OT_STATS_BINS) {
+        bin = OT_STATS_BINS - 1;
+    }
+    ot_stats.histogram[bin]++;
+    ot_stats.inserted++;
+    
+    if (otz < ot_stats.min_otz) ot_stats.min_otz = otz;
+    if (otz > ot_stats.max_otz) ot_stats.max_otz = otz;
+    if (otz > ot_peak_otz) ot_peak_otz = otz;
+    
+    // ClearOTagR leaves each empty entry linked to the one below it
+    if ((ot[index] & 0xFFFFFF) != ((u_long)&ot[index - 1] & 0xFFFFFF)) {
+        ot_stats.collisions++;
+    }
+}
+
+int getRecommendedOTZShift(int ot_length) {
+    int shift = 0;
+    
+    while ((ot_peak_otz >> shift) >= ot_length) {
+        shift++;
+    }
+    return shift;
+}
+
+int getRecommendedOTLength(int shift) {
+    int length = 1;
+    
+    while (length <= (ot_peak_otz >> shift)) {
+        length <<= 1;
+    }
+    return length;
+}
+
+void adaptOTZShift(int ot_length) {
+    int shift = getModelOTZShift();
+    
+    if (ot_stats.rejected_far > 0) {
+        setModelOTZShift(getRecommendedOTZShift(ot_length));
+        ot_tune_settled = 0;
+        ot_peak_otz = 0;
+        return;
+    }
+    
+    // Last frame would still have fit with one bit more precision
+    if (shift > 0 && (ot_stats.max_otz >> (shift - 1)) < ot_length) {
+        if (++ot_tune_settled >= OT_TUNE_SETTLE_FRAMES) {
+            setModelOTZShift(shift - 1);
+            ot_tune_settled = 0;
+            ot_peak_otz = 0;
+        }
+    } else {
+        ot_tune_settled = 0;
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Per-object local ordering tables
+ */
+
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#include <sys/types.h>
+#include <libgte.h>
+#include <libgpu.h>
+
+// Entries in each object's local ordering table
+#ifndef LOCAL_OT_LENGTH
+#define LOCAL_OT_LENGTH 64
+#endif
+
+// A small OT covering one object's depth range, one copy per display
+// buffer. Faces are sorted into it locally and the whole chain is then
+// linked into a single frame OT entry at the object's depth, so objects
+// are ordered against each other by their centres.
+typedef struct {
+    u_long ot[2][LOCAL_OT_LENGTH];
+    long radius;      // Bounding radius around the object origin
+    int z;            // Frame OT entry the chain was last linked at (-1 = culled)
+    
+    // Frame OT mapping saved while the local OT is being filled
+    int saved_shift;
+    long saved_bias;
+} LocalOT;
+
+// Conservative bounding radius of a vertex array around the origin
+long getVertsBoundRadius(SVECTOR *verts, int count);
+
+// Initialize a local OT for an object with the given bounding radius
+void initLocalOT(LocalOT *lot, long radius);
+
+// Clear the local OT for 'buffer' and redirect model rendering into it
+// matrix is the object's composed view matrix (already set on the GTE)
+// Returns the local OT to pass to renderModel with LOCAL_OT_LENGTH
+u_long* beginLocalOT(LocalOT *lot, int buffer, MATRIX *matrix);
+
+// Restore frame OT rendering and link the local chain into ot at the
+// depth of the object's origin; objects outside the frame OT are dropped
+void endLocalOT(LocalOT *lot, int buffer, MATRIX *matrix, u_long *ot, int ot_length);
+
+//----------------------------------------------------------
+// OT statistics and tuning
+// Build with -DOT_STATS to have the model renderers record every
+// depth they insert. Depths are binned before bias/shift (SZ / 4)
+//----------------------------------------------------------
+#define OT_STATS_BINS      64
+#define OT_STATS_BIN_SHIFT 8    // 16384 / OT_STATS_BINS raw depths per bin
+
+// Frames without far rejections before the adaptive shift is lowered
+#define OT_TUNE_SETTLE_FRAMES 60
+
+typedef struct {
+    u_long histogram[OT_STATS_BINS];  // Insertions per raw depth bin
+    u_long inserted;                  // Primitives that landed in an OT
+    u_long rejected_near;             // Index <= 0 (behind/too close)
+    u_long rejected_far;              // Index past the end of the OT
+    u_long rejected_local;            // Outside a local OT (radius too small)
+    u_long collisions;                // Inserts into an already used entry
+    long min_otz;                     // Raw depth range of inserted prims
+    long max_otz;
+} OTStats;
+
+// Statistics for the frame being built
+extern OTStats ot_stats;
+
+// Reset the per-frame statistics (call after ClearOTagR)
+void beginOTStatsFrame(void);
+
+// Record one depth: raw RotAverage otz, the OT index it mapped to and
+// the table it is about to be inserted into
+void recordOTStats(long otz, long index, u_long *ot, int ot_length);
+
+// Smallest OTZ shift that fits the deepest primitive seen into ot_length
+int getRecommendedOTZShift(int ot_length);
+
+// Smallest power-of-two OT length that holds the deepest primitive at shift
+int getRecommendedOTLength(int shift);
+
+// Adjust the frame OTZ shift from the last frame's statistics:
+// raised immediately on far rejections, lowered once depth precision has
+// been wasted for OT_TUNE_SETTLE_FRAMES frames. Call before beginOTStatsFrame
+void adaptOTZShift(int ot_length);
+
+#endif // ORDERING_H
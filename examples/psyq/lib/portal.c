@@ -0,0 +1,154 @@
+/*
+ * Portal/PVS visibility implementation
+ */
+
+#include "portal.h"
+#include "display.h"
+
+int portals_tested = 0;
+
+// Screen rectangle (inclusive)
+typedef struct {
+    short x0, y0, x1, y1;
+} PortalRect;
+
+// Rooms entered by the current traversal, and the union of the
+// rectangles each one was entered through
+static u_long rooms_entered;
+static PortalRect room_rects[32];
+
+int findRoom(PortalWorld *world, long x, long y, long z) {
+    int i;
+    
+    for (i = 0; i < world->room_count; i++) {
+        long *b = world->room_bounds[i];
+        if (x >= b[0] && y >= b[1] && z >= b[2] && x <= b[3] && y <= b[4] && z <= b[5]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------
+// Project a portal and clip its screen bounds against 'clip'
+// Returns 0 when the portal is off screen or outside 'clip'
+//----------------------------------------------------------
+static int projectPortal(Portal *portal, PortalRect *clip, PortalRect *out) {
+    long sxy, p, flag, otz;
+    int i;
+    
+    out->x0 = SCREEN_WIDTH;
+    out->y0 = SCREEN_HEIGHT;
+    out->x1 = -1;
+    out->y1 = -1;
+    portals_tested++;
+    
+    for (i = 0; i < 4; i++) {
+        short sx, sy;
+        
+        otz = RotTransPers(&portal->verts[i], &sxy, &p, &flag);
+        if (otz <= 0) {
+            // Corner behind the camera: the projection is meaningless, keep the clip
+            *out = *clip;
+            return 1;
+        }
+        
+        sx = (short)(sxy & 0xFFFF);
+        sy = (short)(sxy >> 16);
+        if (sx < out->x0) out->x0 = sx;
+        if (sy < out->y0) out->y0 = sy;
+        if (sx > out->x1) out->x1 = sx;
+        if (sy > out->y1) out->y1 = sy;
+    }
+    
+    // Narrow to the rectangle we are looking through
+    if (out->x0 < clip->x0) out->x0 = clip->x0;
+    if (out->y0 < clip->y0) out->y0 = clip->y0;
+    if (out->x1 > clip->x1) out->x1 = clip->x1;
+    if (out->y1 > clip->y1) out->y1 = clip->y1;
+    return out->x0 <= out->x1 && out->y0 <= out->y1;
+}
+
+//----------------------------------------------------------
+// Record entering 'room' through 'rect'
+// Returns 0 when an earlier visit already covered the rectangle, so
+// cyclic room graphs are not walked again for nothing new
+//----------------------------------------------------------
+static int enterRoom(int room, PortalRect *rect) {
+    PortalRect *seen = &room_rects[room];
+    
+    if (!(rooms_entered & (1UL << room))) {
+        rooms_entered |= 1UL << room;
+        *seen = *rect;
+        return 1;
+    }
+    if (rect->x0 >= seen->x0 && rect->y0 >= seen->y0 && rect->x1 <= seen->x1 && rect->y1 <= seen->y1) {
+        return 0;
+    }
+    
+    // Rectangles only grow, so a room is re-entered a bounded number of times
+    if (rect->x0 < seen->x0) seen->x0 = rect->x0;
+    if (rect->y0 < seen->y0) seen->y0 = rect->y0;
+    if (rect->x1 > seen->x1) seen->x1 = rect->x1;
+    if (rect->y1 > seen->y1) seen->y1 = rect->y1;
+    return 1;
+}
+
+//----------------------------------------------------------
+// Flood through portals whose rectangles stay on screen
+//----------------------------------------------------------
+static u_long visitRoom(PortalWorld *world, int room, int from, u_long allowed, PortalRect *clip, int depth) {
+    u_long visible = 1UL << room;
+    int i;
+    
+    if (depth >= PORTAL_MAX_DEPTH) {
+        return visible;
+    }
+    
+    for (i = 0; i < world->portal_count; i++) {
+        Portal *portal = &world->portals[i];
+        PortalRect rect;
+        int other;
+        
+        if (portal->room_a == room) {
+            other = portal->room_b;
+        } else if (portal->room_b == room) {
+            other = portal->room_a;
+        } else {
+            continue;
+        }
+        
+        if (other == from || !(allowed & (1UL << other))) {
+            continue;
+        }
+        if (projectPortal(portal, clip, &rect) && enterRoom(other, &rect)) {
+            visible |= visitRoom(world, other, room, allowed, &rect, depth + 1);
+        }
+    }
+    return visible;
+}
+
+u_long getVisibleRooms(PortalWorld *world, int room, MATRIX *matrix, int narrow) {
+    PortalRect screen;
+    
+    portals_tested = 0;
+    
+    if (room < 0 || room >= world->room_count) {
+        return 0xFFFFFFFF;
+    }
+    if (!narrow) {
+        return world->pvs[room];
+    }
+    
+    // RotTransPers projects relative to the GTE's current matrix
+    SetRotMatrix(matrix);
+    SetTransMatrix(matrix);
+    
+    screen.x0 = 0;
+    screen.y0 = 0;
+    screen.x1 = SCREEN_WIDTH - 1;
+    screen.y1 = SCREEN_HEIGHT - 1;
+    rooms_entered = 0;
+    enterRoom(room, &screen);
+    return visitRoom(world, room, -1, world->pvs[room], &screen, 0);
+}
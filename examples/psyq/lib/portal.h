@@ -0,0 +1,47 @@
+/*
+ * Portal/PVS visibility for indoor levels
+ */
+
+#ifndef PORTAL_H
+#define PORTAL_H
+
+#include <sys/types.h>
+#include <libgte.h>
+
+// Portal between two rooms (matches the <model>-portals.h exporter output)
+#ifndef PORTAL_DEFINED
+#define PORTAL_DEFINED
+typedef struct {
+    short room_a;               // Room in front of the portal plane
+    short room_b;               // Room behind it
+    SVECTOR verts[4];           // Portal corners (model space)
+} Portal;
+#endif
+
+// Deepest chain of portals the screen-rect traversal follows
+#define PORTAL_MAX_DEPTH 8
+
+// Rooms are the model's sub-meshes, so a room mask can be used directly
+// as ModelData.visible_meshes (and there are at most 32 rooms)
+typedef struct {
+    int room_count;
+    int portal_count;
+    long (*room_bounds)[6];     // { min_x, min_y, min_z, max_x, max_y, max_z }
+    Portal *portals;
+    u_long *pvs;                // Potentially visible rooms per room
+} PortalWorld;
+
+// Portals projected by the last getVisibleRooms call
+extern int portals_tested;
+
+// Room containing a model-space point, or -1 when outside every room
+int findRoom(PortalWorld *world, long x, long y, long z);
+
+// Rooms to draw from 'room'. Without narrowing this is the room's PVS.
+// With narrowing, portals are projected through 'matrix' (view * world)
+// and rooms are only added while their portal's screen rectangle
+// overlaps the rectangle of the portals leading to it.
+// Returns all rooms when 'room' is -1 (camera outside the level)
+u_long getVisibleRooms(PortalWorld *world, int room, MATRIX *matrix, int narrow);
+
+#endif // PORTAL_H
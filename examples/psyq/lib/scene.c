@@ -0,0 +1,190 @@
+/*
+ * Scene node transform hierarchy implementation
+ */
+
+#include "scene.h"
+#include "camera.h"
+#include "texture.h"
+#include <string.h>
+
+void initSceneNode(SceneNode *node, SceneNode *parent) {
+    node->parent = parent;
+    node->rotation.vx = 0;
+    node->rotation.vy = 0;
+    node->rotation.vz = 0;
+    node->position.vx = 0;
+    node->position.vy = 0;
+    node->position.vz = 0;
+    node->scale.vx = ONE;
+    node->scale.vy = ONE;
+    node->scale.vz = ONE;
+    node->flags = SCENE_NODE_DIRTY;
+    node->world_version = 0;
+    node->parent_version = 0;
+    node->view_built = 0;
+    node->view_world = 0;
+}
+
+void setSceneNodePosition(SceneNode *node, long x, long y, long z) {
+    node->position.vx = x;
+    node->position.vy = y;
+    node->position.vz = z;
+    node->flags |= SCENE_NODE_DIRTY;
+}
+
+void setSceneNodeRotation(SceneNode *node, short x, short y, short z) {
+    node->rotation.vx = x;
+    node->rotation.vy = y;
+    node->rotation.vz = z;
+    node->flags |= SCENE_NODE_DIRTY;
+}
+
+void setSceneNodeScale(SceneNode *node, long x, long y, long z) {
+    node->scale.vx = x;
+    node->scale.vy = y;
+    node->scale.vz = z;
+    node->flags |= SCENE_NODE_DIRTY;
+    
+    if (x != ONE || y != ONE || z != ONE) {
+        node->flags |= SCENE_NODE_SCALED;
+    } else {
+        node->flags &= ~SCENE_NODE_SCALED;
+    }
+}
+
+MATRIX* getSceneNodeWorldMatrix(SceneNode *node) {
+    u_long parent_version = 0;
+    
+    if (node->parent) {
+        getSceneNodeWorldMatrix(node->parent);
+        parent_version = node->parent->world_version;
+    }
+    
+    if (!(node->flags & SCENE_NODE_DIRTY) && parent_version == node->parent_version) {
+        return &node->world;
+    }
+    
+    // Local transform
+    RotMatrix(&node->rotation, &node->world);
+    if (node->flags & SCENE_NODE_SCALED) {
+        ScaleMatrix(&node->world, &node->scale);
+    }
+    TransMatrix(&node->world, &node->position);
+    
+    // Result = parent world * local
+    if (node->parent) {
+        MATRIX local = node->world;
+        CompMatrix(&node->parent->world, &local, &node->world);
+    }
+    
+    node->flags &= ~SCENE_NODE_DIRTY;
+    node->parent_version = parent_version;
+    node->world_version++;
+    return &node->world;
+}
+
+MATRIX* getSceneNodeViewMatrix(SceneNode *node) {
+    getSceneNodeWorldMatrix(node);
+    
+    if (node->view_built != view_version || node->view_world != node->world_version) {
+        // Result = view_matrix * world
+        CompMatrix(&view_matrix, &node->world, &node->view);
+        node->view_built = view_version;
+        node->view_world = node->world_version;
+    }
+    return &node->view;
+}
+
+MATRIX* setSceneNodeMatrix(SceneNode *node) {
+    MATRIX *matrix = getSceneNodeViewMatrix(node);
+    
+    SetRotMatrix(matrix);
+    SetTransMatrix(matrix);
+    return matrix;
+}
+
+//----------------------------------------------------------
+// Data-driven scene tables
+//----------------------------------------------------------
+int loadSceneTable(
+    const SceneInstance *instances,
+    int instance_count,
+    const char **model_names,
+    int model_count,
+    SceneModel *models,
+    int available_models,
+    SceneObject *objects,
+    int max_objects
+) {
+    SceneModel *resolved[SCENE_MAX_MODELS];
+    int count = 0;
+    int i, j;
+    
+    // Resolve model names once, not per instance
+    for (i = 0; i < model_count && i < SCENE_MAX_MODELS; i++) {
+        resolved[i] = NULL;
+        for (j = 0; j < available_models; j++) {
+            if (strcmp(model_names[i], models[j].name) == 0) {
+                resolved[i] = &models[j];
+                break;
+            }
+        }
+    }
+    
+    for (i = 0; i < instance_count && count < max_objects; i++) {
+        const SceneInstance *inst = &instances[i];
+        SceneObject *obj = &objects[count];
+        
+        if (inst->model < 0 || inst->model >= model_count || inst->model >= SCENE_MAX_MODELS ||
+            !resolved[inst->model]) {
+            continue;
+        }
+        
+        initSceneNode(&obj->node, NULL);
+        setSceneNodePosition(&obj->node, inst->x, inst->y, inst->z);
+        setSceneNodeRotation(&obj->node, inst->rx, inst->ry, inst->rz);
+        setSceneNodeScale(&obj->node, inst->sx, inst->sy, inst->sz);
+        
+        obj->model = resolved[inst->model];
+        obj->tpage = GetSlotTPage(inst->slot);
+        obj->clut = GetSlotClut(inst->slot);
+        obj->visible_meshes = inst->visible_meshes;
+        count++;
+    }
+    
+    return count;
+}
+
+char* renderSceneObjects(SceneObject *objects, int count, char *nextpri, char *end, u_long *ot, int ot_length) {
+    static MATRIX matrices[SCENE_BATCH_MAX];
+    static long radii[SCENE_BATCH_MAX];
+    int i = 0;
+    
+    while (i < count) {
+        SceneObject *first = &objects[i];
+        ModelData *model = first->model->model;
+        int batch = 0;
+        
+        // Gather the run of objects that can share one batch
+        while (i < count && batch < SCENE_BATCH_MAX &&
+               objects[i].model == first->model && objects[i].visible_meshes == first->visible_meshes &&
+               objects[i].tpage == first->tpage && objects[i].clut == first->clut) {
+            VECTOR *scale = &objects[i].node.scale;
+            long largest = scale->vx;
+            
+            // The model radius is unscaled; grow it by the largest axis scale
+            if (scale->vy > largest) largest = scale->vy;
+            if (scale->vz > largest) largest = scale->vz;
+            radii[batch] = (first->model->radius * largest) >> 12;
+            
+            matrices[batch++] = *getSceneNodeViewMatrix(&objects[i].node);
+            i++;
+        }
+        
+        // Visibility is per instance; the model (and its mask) is shared
+        nextpri = renderModelInstances(first->model->verts, model, matrices, radii, batch,
+                                       first->visible_meshes, nextpri, end, ot, ot_length, first->tpage, first->clut);
+    }
+    
+    return nextpri;
+}
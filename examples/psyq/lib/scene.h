@@ -0,0 +1,115 @@
+/*
+ * Scene node transform hierarchy
+ */
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <sys/types.h>
+#include <libgte.h>
+#include "model.h"
+
+// Node flags
+#define SCENE_NODE_DIRTY  (1 << 0)  // Local transform changed since last update
+#define SCENE_NODE_SCALED (1 << 1)  // Scale is not ONE on every axis
+
+// A transform node: local rotation/translation/scale relative to an
+// optional parent. World and view matrices are cached and only rebuilt
+// when the node, one of its ancestors or the camera changed.
+typedef struct SceneNode {
+    struct SceneNode *parent;   // NULL for root nodes
+    
+    // Local transform
+    SVECTOR rotation;
+    VECTOR position;
+    VECTOR scale;               // ONE = unit scale
+    int flags;
+    
+    // Cached matrices
+    MATRIX world;               // parent->world * local
+    MATRIX view;                // view_matrix * world
+    u_long world_version;       // Bumped whenever world is rebuilt
+    u_long parent_version;      // parent->world_version world was built from
+    u_long view_built;          // view_version view was built from
+    u_long view_world;          // world_version view was built from
+} SceneNode;
+
+// Initialize a node at the origin with no rotation and unit scale
+void initSceneNode(SceneNode *node, SceneNode *parent);
+
+// Set the local transform (marks the node dirty)
+void setSceneNodePosition(SceneNode *node, long x, long y, long z);
+void setSceneNodeRotation(SceneNode *node, short x, short y, short z);
+void setSceneNodeScale(SceneNode *node, long x, long y, long z);
+
+// Get the world matrix, rebuilding it (and any dirty ancestors) if needed
+MATRIX* getSceneNodeWorldMatrix(SceneNode *node);
+
+// Get the composed view * world matrix, rebuilding it if needed
+MATRIX* getSceneNodeViewMatrix(SceneNode *node);
+
+// Load the node's view matrix into the GTE for renderModel
+// Returns the matrix so it can also be passed to cached/local OT rendering
+MATRIX* setSceneNodeMatrix(SceneNode *node);
+
+//----------------------------------------------------------
+// Data-driven scene tables
+//----------------------------------------------------------
+
+// Scene table entry (matches the <scene>-scene.h exporter output)
+#ifndef SCENEINSTANCE_DEFINED
+#define SCENEINSTANCE_DEFINED
+typedef struct {
+    int model;              // Index into the scene's model name table
+    long x, y, z;           // Position (scaled by PS1_SCALE)
+    short rx, ry, rz;       // Rotation (4096 = 360 degrees)
+    long sx, sy, sz;        // Scale (4096 = 1.0)
+    int slot;               // Texture slot
+    u_long visible_meshes;  // Sub-mesh visibility mask
+} SceneInstance;
+#endif
+
+// Most distinct models one scene table may reference
+#define SCENE_MAX_MODELS 32
+
+// A model the application makes available to scene tables
+typedef struct {
+    const char *name;           // Header prefix the exporter refers to (e.g. "coin")
+    ModelData *model;
+    SVECTOR *verts;             // Vertices to draw; may be swapped per frame for animation
+    long radius;                // Bounding radius for frustum rejection
+} SceneModel;
+
+// One entry of the render list built from a scene table
+typedef struct {
+    SceneNode node;
+    SceneModel *model;
+    u_short tpage;              // Resolved from the instance's texture slot
+    u_short clut;
+    u_long visible_meshes;
+} SceneObject;
+
+// Build render list entries from an exported scene table
+// Instances whose model is not in 'models' are skipped
+// Returns the number of objects written (at most max_objects)
+int loadSceneTable(
+    const SceneInstance *instances,
+    int instance_count,
+    const char **model_names,
+    int model_count,
+    SceneModel *models,
+    int available_models,
+    SceneObject *objects,
+    int max_objects
+);
+
+// Most instances drawn by one renderModelInstances call
+#define SCENE_BATCH_MAX 64
+
+// Render every object in a render list into the OT
+// Consecutive objects sharing a model and visibility mask are drawn as
+// one instanced batch (the exporter writes instances grouped by model)
+// 'end' is the end of the primitive buffer nextpri points into
+char* renderSceneObjects(SceneObject *objects, int count, char *nextpri, char *end, u_long *ot, int ot_length);
+
+#endif // SCENE_H
@@ -16,15 +16,23 @@
 #include "lib/texture.h"
 #include "lib/camera.h"
 #include "lib/animation.h"
+#include "lib/drawcache.h"
+#include "lib/ordering.h"
+#include "lib/scene.h"
+#include "lib/entity.h"
+#include "lib/collision.h"
 #include "lib/sound.h"
 
 // Include model and animations
 #include "chardata/rika.h"
+#include "chardata/rika-actions.h"
 #include "chardata/ground.h"
+#include "chardata/ground-collision.h"
 #include "chardata/moon.h"
 #include "chardata/coin.h"
-#include "chardata/coin-spin.h"
+#include "chardata/coin-actions.h"
 #include "chardata/star.h"
+#include "chardata/props-scene.h"
 
 // Include texture data for VRAM manager
 #include "chardata/rikatexture.h"
@@ -42,8 +50,52 @@ ModelData moon_model;
 ModelData coin_model;
 ModelData star_model;
 
-// Coin animation state
-int coin_frame = 0;
+// Rika animation player
+AnimPlayer rika_player;
+SVECTOR rika_blend_verts[RIKA_VERTICES_COUNT * 2];  // Crossfade scratch buffer (output + frozen pose)
+
+// Idle/walk crossfade length in vsyncs
+#define RIKA_BLEND_VSYNCS 12
+
+// Rika persistent primitives (one copy per display buffer)
+ModelPrims rika_prims;
+char rika_prim_buffers[2][MODEL_PRIM_BUFFER_MAX(RIKA_FACES_COUNT)];
+
+// Static scenery cached as depth-sorted sub-chains, rebuilt only when the
+// camera moves (one copy per display buffer)
+DrawCache ground_cache;
+DrawCache moon_cache;
+char ground_cache_buffers[2][DRAW_CACHE_BUFFER_SIZE(GROUND_FACES_COUNT)];
+char moon_cache_buffers[2][DRAW_CACHE_BUFFER_SIZE(MOON_FACES_COUNT)];
+
+// Scene nodes (cached world/view matrices)
+SceneNode rika_node;
+SceneNode ground_node;
+SceneNode moon_node;
+
+// Ground collision, hashed by X/Z cell
+CollisionMesh ground_collision;
+int ground_collision_ok = 0;  // 0 if the mesh did not fit COLLISION_MAX_TRIS/ENTRIES
+
+// Per-object local OTs, linked into the frame OT at each object's depth
+// Only rika has one: props and pickups are small, instanced models that
+// sort straight into the frame OT, and a LocalOT per instance would cost
+// 2 * LOCAL_OT_LENGTH words each (128 KB for a full entity store)
+LocalOT rika_lot;
+
+// Static props placed by the exported scene table
+SceneModel scene_models[] = {
+    { "star", &star_model, NULL, 0 },
+};
+#define SCENE_MODEL_STAR 0
+#define SCENE_MODEL_COUNT 1
+SceneObject scene_objects[PROPS_SCENE_INSTANCE_COUNT];
+int scene_object_count = 0;
+
+// Pickups (coins) live in the entity store
+EntityModel entity_models[1];
+#define ENTITY_MODEL_COIN 0
+EntityStore pickups;
 
 //----------------------------------------------------------
 // Texture Slots - each texture gets its own slot
@@ -74,6 +126,10 @@ void initModels(void) {
     rika_model.metallic = NULL;  // Optional: set if exported with metallic
     rika_model.mesh_ids = rika_mesh_ids;
     rika_model.visible_meshes = 0xFFFFFFFF;  // All meshes visible by default
+    rika_model.mesh_count = RIKA_MESH_COUNT;
+    rika_model.tri_ranges = rika_tri_ranges;
+    rika_model.quad_ranges = rika_quad_ranges;
+    rika_model.prim_templates = NULL;  // Built at init if not exported
     
     // Setup ground model data structure
     ground_model.tri_count = GROUND_TRI_COUNT;
@@ -90,6 +146,10 @@ void initModels(void) {
     ground_model.metallic = NULL;  // Optional: set if exported with metallic
     ground_model.mesh_ids = NULL;  // TODO: Re-export ground model
     ground_model.visible_meshes = 0xFFFFFFFF;  // All meshes visible by default
+    ground_model.mesh_count = 0;
+    ground_model.tri_ranges = NULL;
+    ground_model.quad_ranges = NULL;
+    ground_model.prim_templates = NULL;
     
     // Setup moon model data structure
     moon_model.tri_count = MOON_TRI_COUNT;
@@ -106,6 +166,10 @@ void initModels(void) {
     moon_model.metallic = NULL;  // Optional: set if exported with metallic
     moon_model.mesh_ids = NULL;  // TODO: Re-export moon model
     moon_model.visible_meshes = 0xFFFFFFFF;  // All meshes visible by default
+    moon_model.mesh_count = 0;
+    moon_model.tri_ranges = NULL;
+    moon_model.quad_ranges = NULL;
+    moon_model.prim_templates = NULL;
     
     // Setup coin model data structure (with metallic)
     coin_model.tri_count = COIN_TRI_COUNT;
@@ -122,6 +186,10 @@ void initModels(void) {
     coin_model.metallic = coin_metallic;  // Coin uses metallic
     coin_model.mesh_ids = NULL;  // TODO: Re-export coin model
     coin_model.visible_meshes = 0xFFFFFFFF;  // All meshes visible by default
+    coin_model.mesh_count = 0;
+    coin_model.tri_ranges = NULL;
+    coin_model.quad_ranges = NULL;
+    coin_model.prim_templates = NULL;
     
     // Setup star model data structure (with specular)
     star_model.tri_count = STAR_TRI_COUNT;
@@ -138,6 +206,27 @@ void initModels(void) {
     star_model.metallic = NULL;
     star_model.mesh_ids = NULL;  // TODO: Re-export star model
     star_model.visible_meshes = 0xFFFFFFFF;  // All meshes visible by default
+    star_model.mesh_count = 0;
+    star_model.tri_ranges = NULL;
+    star_model.quad_ranges = NULL;
+    star_model.prim_templates = NULL;
+}
+
+//----------------------------------------------------------
+// Bounding radius covering every pose in rika's action table
+//----------------------------------------------------------
+long getRikaBoundRadius(void) {
+    long radius = 0;
+    int i;
+    
+    for (i = 0; i < RIKA_ACTIONS_COUNT; i++) {
+        long r = getVertsBoundRadius(rika_actions[i].frames,
+                                     rika_actions[i].frame_count * rika_actions[i].vertex_count);
+        if (r > radius) {
+            radius = r;
+        }
+    }
+    return radius;
 }
 
 //----------------------------------------------------------
@@ -152,94 +241,89 @@ void loadAllTextures(void) {
 }
 
 //----------------------------------------------------------
-// Render all models
+// Place scene objects (positions only change when gameplay moves them)
 //----------------------------------------------------------
-void renderScene(void) {
-    // Update and set view matrix
-    updateViewMatrix();
-    SetRotMatrix(&view_matrix);
-    SetTransMatrix(&view_matrix);
-    
-    // Render rika model at origin with view matrix
-    nextpri = renderModel(getCurrentAnimVerts(), &rika_model, nextpri, cdb->ot, OT_LENGTH, 
-                          GetSlotTPage(SLOT_0), GetSlotClut(SLOT_0));
-    
-    // Render ground plane positioned below rika
-    MATRIX ground_world_matrix;
-    SVECTOR ground_rot = {0, 0, 0};
-    VECTOR ground_pos = {0, 0, 0};
-    
-    RotMatrix(&ground_rot, &ground_world_matrix);
-    TransMatrix(&ground_world_matrix, &ground_pos);
-    
-    // Compose with view matrix: result = view_matrix * ground_world_matrix
-    MATRIX ground_view_matrix;
-    CompMatrix(&view_matrix, &ground_world_matrix, &ground_view_matrix);
-    
-    SetRotMatrix(&ground_view_matrix);
-    SetTransMatrix(&ground_view_matrix);
+void initScene(void) {
+    AnimAction *spin;
+    long ground_y;
+    int i;
     
-    nextpri = renderModel(ground_vertices, &ground_model, nextpri, cdb->ot, OT_LENGTH, 
-                          GetSlotTPage(SLOT_0), GetSlotClut(SLOT_0));
-    
-    // Render moon plane positioned above rika
-    // Uses VRAM manager slot - texture loaded via BindTexture at init
-    MATRIX moon_world_matrix;
-    SVECTOR moon_rot = {0, 0, 0};
-    VECTOR moon_pos = {0, 0, 0};  // Position moon in the sky
-    
-    RotMatrix(&moon_rot, &moon_world_matrix);
-    TransMatrix(&moon_world_matrix, &moon_pos);
-    
-    // Compose with view matrix: result = view_matrix * moon_world_matrix
-    MATRIX moon_view_matrix;
-    CompMatrix(&view_matrix, &moon_world_matrix, &moon_view_matrix);
-    
-    SetRotMatrix(&moon_view_matrix);
-    SetTransMatrix(&moon_view_matrix);
-    
-    // Get tpage/clut from VRAM manager slot
-    nextpri = renderModel(moon_vertices, &moon_model, nextpri, cdb->ot, OT_LENGTH, 
-                          GetSlotTPage(SLOT_1), GetSlotClut(SLOT_1));
-    
-    // Render coin with spin animation to the left of rika
-    MATRIX coin_world_matrix;
-    SVECTOR coin_rot = {0, 0, 0};
-    VECTOR coin_pos = {-3000, -2000, 0};  // Left of rika
+    // Rika at origin, standing on the ground
+    initSceneNode(&rika_node, NULL);
+    // An oversized mesh is truncated or left empty; rika then keeps y = 0
+    ground_collision_ok = initCollisionMesh(&ground_collision, ground_collision_vertices, ground_collision_tris,
+                                            ground_collision_normals, GROUND_COLLISION_TRI_COUNT,
+                                            GROUND_COLLISION_CELL_SHIFT) == 0;
+    if (getGroundHeight(&ground_collision, 0, 0, 0, &ground_y)) {
+        setSceneNodePosition(&rika_node, 0, ground_y, 0);
+    }
     
-    RotMatrix(&coin_rot, &coin_world_matrix);
-    TransMatrix(&coin_world_matrix, &coin_pos);
+    // Ground plane below rika, moon plane in the sky
+    initSceneNode(&ground_node, NULL);
+    initSceneNode(&moon_node, NULL);
     
-    MATRIX coin_view_matrix;
-    CompMatrix(&view_matrix, &coin_world_matrix, &coin_view_matrix);
+    // Props from the scene table (texture slots must already be bound)
+    // Coins are not in scene_models, so the loader skips them
+    scene_models[SCENE_MODEL_STAR].verts = star_vertices;
+    scene_models[SCENE_MODEL_STAR].radius = getVertsBoundRadius(star_vertices, STAR_VERTICES_COUNT);
+    scene_object_count = loadSceneTable(props_scene, PROPS_SCENE_INSTANCE_COUNT,
+                                        props_scene_models, PROPS_SCENE_MODEL_COUNT,
+                                        scene_models, SCENE_MODEL_COUNT, scene_objects, PROPS_SCENE_INSTANCE_COUNT);
     
-    SetRotMatrix(&coin_view_matrix);
-    SetTransMatrix(&coin_view_matrix);
+    // Coin pickups from the same table, spinning through the baked frames
+    spin = &coin_actions[COIN_ACTION_SPIN];
+    entity_models[ENTITY_MODEL_COIN].model = &coin_model;
+    entity_models[ENTITY_MODEL_COIN].frames = spin->frames;
+    entity_models[ENTITY_MODEL_COIN].frame_count = spin->frame_count;
+    entity_models[ENTITY_MODEL_COIN].vertex_count = spin->vertex_count;
+    entity_models[ENTITY_MODEL_COIN].fps = spin->fps;
+    entity_models[ENTITY_MODEL_COIN].radius = getVertsBoundRadius(spin->frames, spin->frame_count * spin->vertex_count);
+    entity_models[ENTITY_MODEL_COIN].tpage = GetSlotTPage(SLOT_3);
+    entity_models[ENTITY_MODEL_COIN].clut = GetSlotClut(SLOT_3);
+    initEntityStore(&pickups, entity_models);
     
-    // Get current coin animation frame - use VRAM slot for texture
-    SVECTOR *coin_verts = spin_anim[coin_frame];
-    nextpri = renderModel(coin_verts, &coin_model, nextpri, cdb->ot, OT_LENGTH, 
-                          GetSlotTPage(SLOT_3), GetSlotClut(SLOT_3));
+    for (i = 0; i < PROPS_SCENE_INSTANCE_COUNT; i++) {
+        SceneInstance *inst = &props_scene[i];
+        if (inst->model == PROPS_SCENE_MODEL_COIN) {
+            int e = addEntity(&pickups, ENTITY_MODEL_COIN, inst->x, inst->y, inst->z, ENTITY_FLAG_ANIMATED);
+            if (e >= 0) {
+                setEntityTransform(&pickups, e, inst->rx, inst->ry, inst->rz, inst->sx, inst->sy, inst->sz);
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Render all models
+//----------------------------------------------------------
+void renderScene(void) {
+    MATRIX *matrix;
+    u_long *local_ot;
+    char *primbuff_end = primbuff[currentBuffer] + sizeof(primbuff[0]);
     
-    // Update coin animation frame
-    coin_frame = (coin_frame + 1) % SPIN_FRAMES_COUNT;
+    // Update view matrix (node matrices are only recomposed if it changed)
+    updateViewMatrix();
     
-    // Render star to the right of rika - use VRAM slot for texture
-    MATRIX star_world_matrix;
-    SVECTOR star_rot = {0, 0, 0};
-    VECTOR star_pos = {3000, -2000, 0};  // Right of rika
+    // Render rika model
+    matrix = setSceneNodeMatrix(&rika_node);
+    local_ot = beginLocalOT(&rika_lot, currentBuffer, matrix);
+    nextpri = renderModelPrims(getAnimPlayerVerts(&rika_player), &rika_prims, currentBuffer, nextpri, local_ot, LOCAL_OT_LENGTH);
+    endLocalOT(&rika_lot, currentBuffer, matrix, cdb->ot, OT_LENGTH);
     
-    RotMatrix(&star_rot, &star_world_matrix);
-    TransMatrix(&star_world_matrix, &star_pos);
+    // Ground linked behind everything else; only rebuilt when the camera moves
+    renderModelCached(&ground_cache, currentBuffer, ground_vertices, &ground_model, getSceneNodeViewMatrix(&ground_node),
+                      cdb->ot, OT_LENGTH, OT_LENGTH - 1, GetSlotTPage(SLOT_0), GetSlotClut(SLOT_0));
     
-    MATRIX star_view_matrix;
-    CompMatrix(&view_matrix, &star_world_matrix, &star_view_matrix);
+    // Moon uses VRAM manager slot - texture loaded via BindTexture at init
+    renderModelCached(&moon_cache, currentBuffer, moon_vertices, &moon_model, getSceneNodeViewMatrix(&moon_node),
+                      cdb->ot, OT_LENGTH, OT_LENGTH - 1, GetSlotTPage(SLOT_1), GetSlotClut(SLOT_1));
     
-    SetRotMatrix(&star_view_matrix);
-    SetTransMatrix(&star_view_matrix);
+    // Render static props
+    nextpri = renderSceneObjects(scene_objects, scene_object_count, nextpri, primbuff_end, cdb->ot, OT_LENGTH);
     
-    nextpri = renderModel(star_vertices, &star_model, nextpri, cdb->ot, OT_LENGTH, 
-                          GetSlotTPage(SLOT_2), GetSlotClut(SLOT_2));
+    // Render pickups that survive the cull pass
+    cullEntities(&pickups);
+    nextpri = renderEntities(&pickups, nextpri, primbuff_end, cdb->ot, OT_LENGTH);
 }
 
 //----------------------------------------------------------
@@ -251,11 +335,14 @@ int main(void) {
     initGTE();
     initController();
     initCamera();
-    initAnimation();
+    initAnimPlayer(&rika_player, rika_actions, RIKA_ACTIONS_COUNT);
+    setAnimBlendBuffer(&rika_player, rika_blend_verts);
+    rika_player.flags |= ANIM_FLAG_INTERPOLATE;  // Smooth 30fps actions at 60Hz
     
     // Initialize VRAM manager and load all textures
     initVRAMManager();
     loadAllTextures();
+    initScene();
     
     // Initialize sound system
     initSound();
@@ -265,32 +352,60 @@ int main(void) {
     setCDVolume(10);
 
     initModels();
+    initModelPrims(&rika_prims, &rika_model, rika_prim_buffers[0], rika_prim_buffers[1],
+                   GetSlotTPage(SLOT_0), GetSlotClut(SLOT_0));
+    initDrawCache(&ground_cache, ground_cache_buffers[0], ground_cache_buffers[1], sizeof(ground_cache_buffers[0]));
+    initLocalOT(&rika_lot, getRikaBoundRadius());
+    initDrawCache(&moon_cache, moon_cache_buffers[0], moon_cache_buffers[1], sizeof(moon_cache_buffers[0]));
     
     // Main loop
     while (1) {
         // Handle input
         handleInput();
         
-        // Circle button to toggle head visibility (mesh 3)
-        if ((padState & PADRright) && !(padStateOld & PADRright)) {
-            rika_model.visible_meshes ^= (1 << 3);  // Toggle bit 3 (Head)
+        // Triangle button to switch animation
+        if ((padState & PADRup) && !(padStateOld & PADRup)) {
+            blendAnimAction(&rika_player, rika_player.action == RIKA_ACTION_IDLE ? RIKA_ACTION_WALK : RIKA_ACTION_IDLE,
+                            RIKA_BLEND_VSYNCS);
         }
         
-        // Update animation
-        updateAnimation();
+        // Circle button to toggle head visibility
+        if ((padState & PADRright) && !(padStateOld & PADRright)) {
+            rika_model.visible_meshes ^= (1 << RIKA_MESH_HEAD);
+        }
         
         // Swap double buffer
         swapBuffers();
         
+        // Update animation by the vsyncs the last frame took
+        beginAnimCacheFrame();
+        updateAnimPlayer(&rika_player, frameVSyncs);
+        updateEntities(&pickups, frameVSyncs);
+        
         // Clear ordering table
         ClearOTagR(cdb->ot, OT_LENGTH);
         
+#ifdef OT_STATS
+        // Last frame's depth usage; OT_TUNE adapts the shift to it
+        FntPrint(fontId, "OT: %d in, %d near, %d far, %d coll\n", ot_stats.inserted,
+                 ot_stats.rejected_near, ot_stats.rejected_far + ot_stats.rejected_local, ot_stats.collisions);
+        FntPrint(fontId, "OTZ %d-%d shift %d (rec %d, len %d)\n", ot_stats.min_otz, ot_stats.max_otz,
+                 getModelOTZShift(), getRecommendedOTZShift(OT_LENGTH), getRecommendedOTLength(getModelOTZShift()));
+#ifdef OT_TUNE
+        adaptOTZShift(OT_LENGTH);
+#endif
+        beginOTStatsFrame();
+#endif
+        
         // Display animation state
-        FntPrint(fontId, "Animation: %s\n", current_anim == 0 ? "IDLE" : "WALK");
-        FntPrint(fontId, "Frame: %d/%d\n", current_frame, getAnimFrameCount());
+        FntPrint(fontId, "Animation: %s\n", rika_actions[rika_player.action].name);
+        FntPrint(fontId, "Frame: %d/%d\n", getAnimPlayerFrame(&rika_player), getAnimPlayerFrameCount(&rika_player));
         FntPrint(fontId, "Camera: X=%d Y=%d Z=%d\n", camera_position.vx, camera_position.vy, camera_position.vz);
         FntPrint(fontId, "VRAM Slots: 4/%d in use\n", VRAM_SLOT_COUNT);
-        FntPrint(fontId, "Head: %s (Circle to toggle)\n", (rika_model.visible_meshes & (1 << 3)) ? "ON" : "OFF");
+        FntPrint(fontId, "Head: %s (Circle to toggle)\n", (rika_model.visible_meshes & (1 << RIKA_MESH_HEAD)) ? "ON" : "OFF");
+        if (!ground_collision_ok) {
+            FntPrint(fontId, "Collision mesh over COLLISION_MAX_TRIS/ENTRIES\n");
+        }
         FntFlush(fontId);
         
         // Render scene
@@ -13,35 +13,97 @@ bl_info = {
 import bpy
 import bmesh
 import mathutils
+import argparse
+import filecmp
+import fnmatch
+import hashlib
+import itertools
+import json
+import math
 import os
+import sys
+import tempfile
+import time
+import numpy as np
 from bpy_extras.io_utils import ExportHelper
-from bpy.props import StringProperty, BoolProperty, IntProperty, EnumProperty
+from bpy.props import StringProperty, BoolProperty, IntProperty, FloatProperty, EnumProperty
 from bpy.types import Operator
 
 # PlayStation 1 fixed-point scale factor (standard for PS1 hardware)
 PS1_SCALE_FACTOR = 3072
 
+# SVECTOR components are 16-bit; anything outside wraps silently on the PS1
+SVECTOR_MIN = -32768
+SVECTOR_MAX = 32767
+
+# Sub-mesh visibility is a 32-bit mask (model.h MODEL_MAX_MESHES)
+MODEL_MAX_MESHES = 32
+
 def show_message(message="", title="Message", icon='INFO'):
     """Show a message box to the user"""
     def draw(self, context):
         self.layout.label(text=message)
     bpy.context.window_manager.popup_menu(draw, title=title, icon=icon)
 
-def mesh_triangulate(obj):
-    """Triangulate faces with more than 4 vertices, then convert back to quads where possible"""
-    me = obj.data
+def split_ngons(mesh):
+    """Triangulate faces with more than 4 vertices, then rejoin the pieces into quads where possible
+    Vertices are neither added nor reordered, so baked frames still line up. Returns True if any face was split"""
+    loop_total = np.empty(len(mesh.polygons), dtype=np.int32)
+    mesh.polygons.foreach_get("loop_total", loop_total)
+    if not (loop_total > 4).any():
+        return False
+    
     bm = bmesh.new()
-    bm.from_mesh(me)
-    bmesh.ops.triangulate(bm, faces=bm.faces)
-    bm.to_mesh(me)
+    bm.from_mesh(mesh)
+    ngons = [face for face in bm.faces if len(face.verts) > 4]
+    result = bmesh.ops.triangulate(bm, faces=ngons)
+    
+    # Same thresholds as Blender's Tris to Quads (PS1 supports both tris and quads)
+    bmesh.ops.join_triangles(bm, faces=result['faces'], cmp_materials=True, cmp_uvs=True,
+                             angle_face_threshold=math.radians(40.0),
+                             angle_shape_threshold=math.radians(40.0))
+    bm.to_mesh(mesh)
     bm.free()
+    return True
+
+def build_export_meshes(mesh_objects):
+    """Temporary copies of the meshes as evaluated (modifiers applied) with their n-gons split
+    The artist's meshes and the current mode are never touched. Armature modifiers are left
+    out so the model keeps its rest pose; animation frames are baked from the full stack.
+    Returns (meshes, split count); the caller frees the meshes with bpy.data.meshes.remove"""
+    armatures = [modifier for obj in mesh_objects for modifier in obj.modifiers
+                 if modifier.type == 'ARMATURE' and modifier.show_viewport]
+    for modifier in armatures:
+        modifier.show_viewport = False
     
-    # Try to convert back to quads (PS1 supports both tris and quads)
-    bpy.context.view_layer.objects.active = obj
-    bpy.ops.object.mode_set(mode='EDIT')
-    bpy.ops.mesh.select_all(action='SELECT')
-    bpy.ops.mesh.tris_convert_to_quads()
-    bpy.ops.object.mode_set(mode='OBJECT')
+    meshes = []
+    split = 0
+    try:
+        bpy.context.view_layer.update()
+        depsgraph = bpy.context.evaluated_depsgraph_get()
+        for obj in mesh_objects:
+            mesh = bpy.data.meshes.new_from_object(obj.evaluated_get(depsgraph),
+                                                   preserve_all_data_layers=True, depsgraph=depsgraph)
+            meshes.append(mesh)
+            if split_ngons(mesh):
+                split += 1
+    except Exception:
+        for mesh in meshes:
+            bpy.data.meshes.remove(mesh)
+        raise
+    finally:
+        for modifier in armatures:
+            modifier.show_viewport = True
+        bpy.context.view_layer.update()
+    return meshes, split
+
+def check_svector_range(values, what):
+    """Raise ExportError when fixed-point coordinates do not fit an SVECTOR"""
+    values = np.asarray(values)
+    if values.size and (values.min() < SVECTOR_MIN or values.max() > SVECTOR_MAX):
+        raise ExportError(f"{what} go past the 16-bit SVECTOR range "
+                          f"(about {SVECTOR_MAX / PS1_SCALE_FACTOR:.1f} Blender units from the origin); "
+                          f"scale the scene down or move it closer to the origin")
 
 def convert_coordinate(coord, convert_to_z_up):
     """Convert Blender Y-up coordinates to PS1 Z-up: (x, -z, y)"""
@@ -49,13 +111,81 @@ def convert_coordinate(coord, convert_to_z_up):
         return (coord[0], -coord[2], coord[1])
     return coord
 
+def read_mesh_arrays(mesh):
+    """Bulk-read the mesh data export_model needs into NumPy arrays"""
+    vertex_count = len(mesh.vertices)
+    loop_count = len(mesh.loops)
+    poly_count = len(mesh.polygons)
+    
+    co = np.empty(vertex_count * 3, dtype=np.float32)
+    mesh.vertices.foreach_get("co", co)
+    normal = np.empty(vertex_count * 3, dtype=np.float32)
+    if hasattr(mesh, "vertex_normals"):
+        mesh.vertex_normals.foreach_get("vector", normal)
+    else:
+        mesh.vertices.foreach_get("normal", normal)
+    
+    loop_vertex = np.empty(loop_count, dtype=np.int32)
+    mesh.loops.foreach_get("vertex_index", loop_vertex)
+    
+    loop_start = np.empty(poly_count, dtype=np.int32)
+    loop_total = np.empty(poly_count, dtype=np.int32)
+    material_index = np.empty(poly_count, dtype=np.int32)
+    use_smooth = np.empty(poly_count, dtype=bool)
+    mesh.polygons.foreach_get("loop_start", loop_start)
+    mesh.polygons.foreach_get("loop_total", loop_total)
+    mesh.polygons.foreach_get("material_index", material_index)
+    mesh.polygons.foreach_get("use_smooth", use_smooth)
+    
+    uv = None
+    if mesh.uv_layers.active:
+        uv = np.empty(loop_count * 2, dtype=np.float32)
+        mesh.uv_layers.active.data.foreach_get("uv", uv)
+        uv = uv.reshape(loop_count, 2).astype(np.float64)
+    
+    return {
+        'co': co.reshape(vertex_count, 3),
+        'normal': normal.reshape(vertex_count, 3),
+        'loop_vertex': loop_vertex,
+        'loop_start': loop_start,
+        'loop_total': loop_total,
+        'material_index': material_index,
+        'use_smooth': use_smooth,
+        'uv': uv,
+    }
+
+def transform_points(matrix, points):
+    """matrix @ point for an (N, 3) array, rounded as mathutils rounds it so
+    results truncate to the same fixed point: float products summed in
+    double, stored as float. A 4x4 matrix adds its translation"""
+    m = np.array(matrix, dtype=np.float32)
+    points = np.asarray(points, dtype=np.float32)
+    out = (points[:, 0:1] * m[:3, 0]).astype(np.float64)
+    out += points[:, 1:2] * m[:3, 1]
+    out += points[:, 2:3] * m[:3, 2]
+    if len(m) == 4:
+        out += m[:3, 3]
+    return out.astype(np.float32)
+
+def normalize_points(vectors):
+    """Vector.normalized() for an (N, 3) float32 array, with mathutils'
+    float rounding; vectors too short to normalise become zero"""
+    squares = vectors * vectors
+    dot = ((squares[:, 2].astype(np.float64) + squares[:, 1]) + squares[:, 0]).astype(np.float32)
+    valid = dot > np.float32(1.0e-35)
+    scale = np.float32(1.0) / np.sqrt(np.where(valid, dot, np.float32(1.0)))
+    return np.where(valid[:, None], vectors * scale[:, None], np.float32(0.0))
+
+def convert_coordinates(coords, convert_to_z_up):
+    """convert_coordinate for an (N, 3) array"""
+    if convert_to_z_up:
+        return coords[:, [0, 2, 1]] * np.array((1.0, -1.0, 1.0))
+    return coords
+
 def get_vertex_colors(mesh):
-    """Extract vertex colors from mesh - Blender 4.0+ compatible
-    Returns: (colors_list, domain_type)
+    """Extract the first colour attribute as an (N, 3) float array - Blender 4.0+ compatible
+    Returns: (colors or None, domain_type)
     """
-    vert_colors = []
-    color_domain = None
-    
     color_attrs = []
     
     # Try color_attributes (Blender 4.0+)
@@ -68,68 +198,44 @@ def get_vertex_colors(mesh):
             if hasattr(attr, 'data_type') and attr.data_type in ['BYTE_COLOR', 'FLOAT_COLOR']:
                 color_attrs.append(attr)
     
-    # Extract first color attribute
     for attr in color_attrs:
-        color_domain = attr.domain
-        
-        for d in attr.data:
-            color = None
-            if hasattr(d, 'color_srgb'):
-                color = mathutils.Color((d.color_srgb[0], d.color_srgb[1], d.color_srgb[2]))
-            elif hasattr(d, 'color'):
-                color = mathutils.Color((d.color[0], d.color[1], d.color[2]))
-            elif hasattr(d, 'vector'):
-                color = mathutils.Color((d.vector[0], d.vector[1], d.vector[2]))
-            
-            if color:
-                vert_colors.append(color)
-        
-        if vert_colors:
-            break
+        count = len(attr.data)
+        if count == 0:
+            continue
+        for prop, width in (('color_srgb', 4), ('color', 4), ('vector', 3)):
+            if hasattr(attr.data[0], prop):
+                values = np.empty(count * width, dtype=np.float32)
+                attr.data.foreach_get(prop, values)
+                return values.reshape(count, width)[:, :3].astype(np.float64), attr.domain
     
-    return vert_colors, color_domain
+    return None, None
 
-def get_poly_color(poly, vert_colors, color_domain, mesh):
-    """Get color for a specific polygon"""
-    if not vert_colors or color_domain is None:
-        return None
-    
-    colors = []
+def get_face_color_mask(colors, color_domain, arrays):
+    """Per-polygon flag: True when any of the face's colours is not white"""
+    poly_count = len(arrays['loop_start'])
+    if colors is None or poly_count == 0:
+        return np.zeros(poly_count, dtype=bool)
     
+    not_white = (colors < 0.99).any(axis=1)
     if color_domain == 'CORNER':
-        for i in range(len(poly.vertices)):
-            idx = poly.loop_start + i
-            if idx < len(vert_colors):
-                colors.append(vert_colors[idx])
+        per_loop = not_white
     elif color_domain == 'VERTEX':
-        for vert_idx in poly.vertices:
-            if vert_idx < len(vert_colors):
-                colors.append(vert_colors[vert_idx])
+        per_loop = not_white[arrays['loop_vertex']]
     elif color_domain == 'FACE':
-        if poly.index < len(vert_colors):
-            colors.append(vert_colors[poly.index])
-    
-    return colors
-
-def is_solid_white(poly, vert_colors, color_domain, mesh):
-    """Check if polygon is solid white"""
-    colors = get_poly_color(poly, vert_colors, color_domain, mesh)
-    
-    if not colors or len(colors) == 0:
-        return True
-    
-    for c in colors:
-        if c.r < 0.99 or c.g < 0.99 or c.b < 0.99:
-            return False
-    return True
+        return not_white[:poly_count]
+    else:
+        return np.zeros(poly_count, dtype=bool)
+    return np.logical_or.reduceat(per_loop, arrays['loop_start'])
 
-def detect_material_properties(mesh, poly, enable_unlit, enable_specular, enable_metallic):
-    """Detect material properties: lit/unlit, textured, vertex colors, smooth/flat, alpha, specular, metallic"""
+def get_material_properties(mat, enable_unlit, enable_specular, enable_metallic):
+    """Detect material properties shared by every face using a material slot:
+    lit/unlit, textured, alpha, specular, metallic. Per-face smooth shading
+    and vertex colours are filled in by the caller"""
     result = {
         'is_lit': True,
         'is_textured': False,
         'has_vertex_colors': False,
-        'is_smooth': poly.use_smooth,
+        'is_smooth': False,
         'texture_name': None,
         'texture_index': -1,  # Index into texture list, -1 = no texture
         'texture_width': 255,  # Default if no texture
@@ -141,51 +247,42 @@ def detect_material_properties(mesh, poly, enable_unlit, enable_specular, enable
         'metallic': 0.0  # Default metallic value
     }
     
-    # Check material
-    if poly.material_index < len(mesh.materials):
-        mat = mesh.materials[poly.material_index]
-        
-        if mat and mat.node_tree:
-            # Check for Principled BSDF to get specular and metallic values
-            for node in mat.node_tree.nodes:
-                if node.type == 'BSDF_PRINCIPLED':
-                    # Get specular value if enabled (0.0 to 1.0 range in Blender 4.0)
-                    if enable_specular:
-                        # Blender 4.0 uses "Specular IOR Level"
-                        for input_name in ['Specular IOR Level', 'Specular', 'Specular IOR']:
-                            if input_name in node.inputs:
-                                try:
-                                    value = node.inputs[input_name].default_value
-                                    result['specular'] = float(value)
-                                    break
-                                except Exception as e:
-                                    pass
-                    
-                    # Get metallic value if enabled
-                    if enable_metallic:
-                        if 'Metallic' in node.inputs:
+    if mat and mat.node_tree:
+        # Check for Principled BSDF to get specular and metallic values
+        for node in mat.node_tree.nodes:
+            if node.type == 'BSDF_PRINCIPLED':
+                # Get specular value if enabled (0.0 to 1.0 range in Blender 4.0)
+                if enable_specular:
+                    # Blender 4.0 uses "Specular IOR Level"
+                    for input_name in ['Specular IOR Level', 'Specular', 'Specular IOR']:
+                        if input_name in node.inputs:
                             try:
-                                result['metallic'] = float(node.inputs['Metallic'].default_value)
-                            except:
+                                value = node.inputs[input_name].default_value
+                                result['specular'] = float(value)
+                                break
+                            except Exception as e:
                                 pass
                 
-                # Check for texture and get dimensions
-                if node.type in ['TEX_IMAGE', 'ShaderNodeTexImage']:
-                    if node.image:
-                        result['is_textured'] = True
-                        result['texture_name'] = node.image.name
-                        # Get texture dimensions
-                        result['texture_width'] = node.image.size[0]
-                        result['texture_height'] = node.image.size[1]
-                        
-                        # Check if texture has alpha channel
-                        if node.image.channels == 4 or (hasattr(node.image, 'alpha_mode') and node.image.alpha_mode != 'NONE'):
-                            result['has_alpha'] = True
-    
-    # Check vertex colors (now returns both colors and domain)
-    vert_colors, color_domain = get_vertex_colors(mesh)
-    if vert_colors and color_domain and not is_solid_white(poly, vert_colors, color_domain, mesh):
-        result['has_vertex_colors'] = True
+                # Get metallic value if enabled
+                if enable_metallic:
+                    if 'Metallic' in node.inputs:
+                        try:
+                            result['metallic'] = float(node.inputs['Metallic'].default_value)
+                        except:
+                            pass
+            
+            # Check for texture and get dimensions
+            if node.type in ['TEX_IMAGE', 'ShaderNodeTexImage']:
+                if node.image:
+                    result['is_textured'] = True
+                    result['texture_name'] = node.image.name
+                    # Get texture dimensions
+                    result['texture_width'] = node.image.size[0]
+                    result['texture_height'] = node.image.size[1]
+                    
+                    # Check if texture has alpha channel
+                    if node.image.channels == 4 or (hasattr(node.image, 'alpha_mode') and node.image.alpha_mode != 'NONE'):
+                        result['has_alpha'] = True
     
     # Only set unlit if enable_unlit is checked
     if enable_unlit:
@@ -193,134 +290,786 @@ def detect_material_properties(mesh, poly, enable_unlit, enable_specular, enable
     
     return result
 
-class ExportPS1(Operator, ExportHelper):
-    """Export to PlayStation 1 C header format"""
-    bl_idname = "export_scene.ps1"
-    bl_label = "Export PS1"
+def build_weld_map(key_columns, used):
+    """Merge vertices whose key rows are identical, keeping only the used ones
+    key_columns are integer arrays with one row per vertex. Returns (kept, remap):
+    the original index of each output vertex in first-use order, and each
+    original vertex's output index (-1 when it is dropped)"""
+    used_indices = np.nonzero(used)[0]
+    keys = np.concatenate(key_columns, axis=1)[used_indices]
+    _, first, inverse = np.unique(keys, axis=0, return_index=True, return_inverse=True)
     
-    filename_ext = ".h"
+    # np.unique sorts its rows; number output vertices by first use instead
+    order = np.argsort(first)
+    rank = np.empty(len(order), dtype=np.int64)
+    rank[order] = np.arange(len(order))
     
-    filter_glob: StringProperty(
-        default="*.h",
-        options={'HIDDEN'},
-        maxlen=255,
-    )
+    remap = np.full(len(used), -1, dtype=np.int64)
+    remap[used_indices] = rank[inverse.ravel()]
+    return used_indices[first[order]], remap
+
+# Corner order per face size: triangles [0, 2, 1], quads [3, 2, 0, 1]
+FACE_LOOP_ORDER = np.array([
+    [0, 0, 0, 0],
+    [0, 0, 0, 0],
+    [0, 0, 0, 0],
+    [0, 2, 1, 0],
+    [3, 2, 0, 1],
+], dtype=np.int32)
+
+class HeaderWriter:
+    """Streams a header file to disk. Text goes through a large write buffer
+    and array rows are formatted a chunk at a time with a single % operation,
+    so output time stays linear in the file size.
     
-    convert_coords: BoolProperty(
-        name="Convert to Z-up",
-        description="Convert Blender Y-up coordinates to PS1 Z-up (x, -z, y)",
-        default=True
-    )
+    Output goes to a uniquely named temporary file in the same directory that
+    only replaces the header when the contents differ, so unchanged headers
+    keep their mtime and the C build does not recompile what includes them.
+    Exports running side by side never share a temporary file.
+    With a staged list the finished writer is appended to it instead, and the
+    header is only replaced (or not) by a later commit() or discard()."""
+    CHUNK_ROWS = 4096
     
-    enable_unlit: BoolProperty(
-        name="Enable Unlit",
-        description="Export all polygons as unlit (disable lighting calculations)",
-        default=False
-    )
+    def __init__(self, filepath, staged=None):
+        self.filepath = filepath
+        self.staged = staged
+        fd, self.temp_path = tempfile.mkstemp(prefix=os.path.basename(filepath) + ".",
+                                              suffix=".tmp", dir=os.path.dirname(filepath) or ".")
+        self.file = os.fdopen(fd, 'w', encoding='utf-8', buffering=1 << 20)
     
-    enable_semi_transparency: BoolProperty(
-        name="Enable Semi-Transparency",
-        description="Enable semi-transparency for materials with alpha channels",
-        default=False
-    )
+    def __enter__(self):
+        return self
     
-    enable_cutout_transparency: BoolProperty(
-        name="Enable Cutout Transparency",
-        description="Enable sharp cutout transparency using mask bit (bit 15) for textures with alpha",
-        default=False
-    )
+    def __exit__(self, exc_type, *exc):
+        self.file.close()
+        if exc_type is not None:
+            self.discard()
+        elif self.staged is not None:
+            self.staged.append(self)
+        else:
+            self.commit()
     
-    enable_specular: BoolProperty(
-        name="Enable Specular",
-        description="Export specular IOR values from Principled BSDF for specular highlights",
-        default=False
-    )
+    def commit(self):
+        """Replace the header with the new contents if they differ"""
+        if os.path.exists(self.filepath) and filecmp.cmp(self.filepath, self.temp_path, shallow=False):
+            os.remove(self.temp_path)
+            return
+        # mkstemp files are private; give the header the usual permissions
+        umask = os.umask(0)
+        os.umask(umask)
+        os.chmod(self.temp_path, 0o666 & ~umask)
+        os.replace(self.temp_path, self.filepath)
     
-    enable_metallic: BoolProperty(
-        name="Enable Metallic",
-        description="Export metallic values from Principled BSDF for metallic materials",
-        default=False
-    )
+    def discard(self):
+        os.remove(self.temp_path)
     
-    export_animations: BoolProperty(
-        name="Export Animations",
-        description="Export all actions as separate animation header files",
-        default=True
-    )
+    def write(self, text):
+        self.file.write(text)
     
-    header_type: EnumProperty(
-        name="Header Type",
-        description="Choose the header file format",
-        items=[
-            ('PSYQ', "PSyQ (C)", "Export for PSyQ SDK (C) with libgte.h"),
-            ('PSYQO', "PSyQo (C++)", "Export for PSyQo SDK (C++) with stdint.h"),
-        ],
-        default='PSYQ'
-    )
+    def rows(self, row_format, rows):
+        """Write row_format once per row of a 2D integer array (or list of lists)"""
+        for start in range(0, len(rows), self.CHUNK_ROWS):
+            chunk = rows[start:start + self.CHUNK_ROWS]
+            if isinstance(chunk, np.ndarray):
+                values = chunk.ravel().tolist()
+            else:
+                values = [value for row in chunk for value in row]
+            self.file.write((row_format * len(chunk)) % tuple(values))
+
+# GPU packet layouts for the primitive templates, keyed on (textured, smooth, is_quad)
+# Each entry is (code, words) where words lists what every 32-bit word holds
+PRIM_TEMPLATE_LAYOUTS = {
+    (False, False, False): (0x20, ['tag', 'rgb0', 'xy', 'xy', 'xy']),                                            # POLY_F3
+    (True, False, False): (0x24, ['tag', 'rgb0', 'xy', 'uv0', 'xy', 'uv1', 'xy', 'uv2']),                         # POLY_FT3
+    (False, True, False): (0x30, ['tag', 'rgb0', 'xy', 'rgb1', 'xy', 'rgb2', 'xy']),                              # POLY_G3
+    (True, True, False): (0x34, ['tag', 'rgb0', 'xy', 'uv0', 'rgb1', 'xy', 'uv1', 'rgb2', 'xy', 'uv2']),          # POLY_GT3
+    (False, False, True): (0x28, ['tag', 'rgb0', 'xy', 'xy', 'xy', 'xy']),                                        # POLY_F4
+    (True, False, True): (0x2C, ['tag', 'rgb0', 'xy', 'uv0', 'xy', 'uv1', 'xy', 'uv2', 'xy', 'uv3']),             # POLY_FT4
+    (False, True, True): (0x38, ['tag', 'rgb0', 'xy', 'rgb1', 'xy', 'rgb2', 'xy', 'rgb3', 'xy']),                 # POLY_G4
+    (True, True, True): (0x3C, ['tag', 'rgb0', 'xy', 'uv0', 'rgb1', 'xy', 'uv1', 'rgb2', 'xy', 'uv2', 'rgb3', 'xy', 'uv3']),  # POLY_GT4
+}
+
+# Target sizes in bytes of the C types the headers declare, for the stats report
+C_TYPE_SIZES = {
+    'unsigned char': 1, 'unsigned short': 2, 'uint16_t': 2, 'short': 2, 'int16_t': 2,
+    'int': 4, 'long': 4, 'u_long': 4, 'int32_t': 4, 'uint32_t': 4, 'const char *': 4,
+    'SVECTOR': 8, 'CVECTOR': 4, 'Portal': 36, 'SceneInstance': 44, 'AnimAction': 20,
+}
+
+def new_header_stats(**extra):
+    """Per-header figures for the stats report; 'arrays' maps array name to bytes"""
+    return dict(extra, arrays={})
+
+def add_array(stats, name, ctype, count):
+    stats['arrays'][name] = C_TYPE_SIZES[ctype] * count
+
+def get_texture_vram_bytes(width, height, bpp):
+    """VRAM taken by a texture at 4, 8 or 16 bits per pixel, including its CLUT"""
+    clut = 2 << bpp if bpp < 16 else 0
+    return width * height * bpp // 8 + clut
+
+def build_stats_report(base_name, header_stats, texture_bpp):
+    """Combine the per-header stats of one export into the JSON report"""
+    report = {'model': base_name, 'headers': {}, 'animations': {}, 'textures': {}}
+    ram_bytes = 0
+    animation_bytes = 0
+    for filename, stats in sorted(header_stats.items()):
+        size = sum(stats['arrays'].values())
+        report['headers'][filename] = {'bytes': size, 'arrays': stats['arrays']}
+        ram_bytes += size
+        if 'action' in stats:
+            report['animations'][stats['action']] = {'frames': stats['frames'], 'vertices': stats['vertices'], 'bytes': size}
+            animation_bytes += size
+        for key in ('geometry', 'primitives'):
+            if key in stats:
+                report[key] = stats[key]
     
-    def draw(self, context):
-        layout = self.layout
-        layout.label(text="Export options:")
-        layout.prop(self, "convert_coords")
-        layout.prop(self, "enable_unlit")
-        layout.prop(self, "enable_semi_transparency")
-        layout.prop(self, "enable_cutout_transparency")
-        layout.prop(self, "enable_specular")
-        layout.prop(self, "enable_metallic")
-        layout.prop(self, "export_animations")
-        layout.label(text="Header Type:")
-        layout.prop(self, "header_type", text="")
+    model = header_stats.get(base_name + ".h", {})
+    for name, (width, height) in sorted(model.get('textures', {}).items()):
+        report['textures'][name] = {'width': width, 'height': height, 'bpp': texture_bpp,
+                                    'vram_bytes': get_texture_vram_bytes(width, height, texture_bpp)}
     
-    def execute(self, context):
-        return self.export_ps1(context)
+    report['totals'] = {
+        'ram_bytes': ram_bytes,
+        'animation_bytes': animation_bytes,
+        'vram_bytes': sum(t['vram_bytes'] for t in report['textures'].values()),
+        'gpu_packet_bytes_per_frame': model.get('packet_bytes', 0),
+    }
+    return report
+
+def build_face_grid(vertices, faces, cell_size):
+    """Assign each face to an X/Z grid cell by centroid (sets face['cell'])
+    and return the grid layout with per-cell bounding spheres"""
+    cell_size = max(1, cell_size)
+    min_x = min(v[0] for v in vertices)
+    min_z = min(v[2] for v in vertices)
+    max_x = max(v[0] for v in vertices)
+    max_z = max(v[2] for v in vertices)
+    width = max_x // cell_size - min_x // cell_size + 1
+    depth = max_z // cell_size - min_z // cell_size + 1
+    origin_x = (min_x // cell_size) * cell_size
+    origin_z = (min_z // cell_size) * cell_size
     
-    def export_ps1(self, context):
-        """Main export function"""
-        blend_filepath = bpy.data.filepath
-        if not blend_filepath:
-            show_message("Please save your .blend file first!", "Error", 'ERROR')
-            return {'CANCELLED'}
+    # Per-cell AABB of the faces assigned to it
+    boxes = [None] * (width * depth)
+    for face in faces:
+        corners = [vertices[i] for i in face['vertices']]
+        cx = sum(v[0] for v in corners) // len(corners)
+        cz = sum(v[2] for v in corners) // len(corners)
+        cell = ((cz - origin_z) // cell_size) * width + (cx - origin_x) // cell_size
+        face['cell'] = cell
         
-        base_name = os.path.splitext(os.path.basename(blend_filepath))[0]
-        export_dir = os.path.dirname(self.filepath)
+        box = boxes[cell] or [[1 << 30] * 3, [-(1 << 30)] * 3]
+        for v in corners:
+            for axis in range(3):
+                box[0][axis] = min(box[0][axis], v[axis])
+                box[1][axis] = max(box[1][axis], v[axis])
+        boxes[cell] = box
+    
+    bounds = []
+    margin = 0
+    for cell, box in enumerate(boxes):
+        if box is None:
+            bounds.append((0, 0, 0, 0))
+            continue
+        center = [(box[0][a] + box[1][a]) // 2 for a in range(3)]
+        radius = int(math.ceil(math.sqrt(sum(((box[1][a] - box[0][a]) / 2) ** 2 for a in range(3))))) + 1
+        bounds.append((center[0], center[1], center[2], radius))
+        
+        # How far this cell's faces reach past the cell's own square
+        x0 = origin_x + (cell % width) * cell_size
+        z0 = origin_z + (cell // width) * cell_size
+        margin = max(margin, x0 - box[0][0], box[1][0] - (x0 + cell_size),
+                     z0 - box[0][2], box[1][2] - (z0 + cell_size))
+    
+    return {
+        'cell_size': cell_size,
+        'width': width,
+        'depth': depth,
+        'origin_x': origin_x,
+        'origin_z': origin_z,
+        'min_y': min(v[1] for v in vertices),
+        'max_y': max(v[1] for v in vertices),
+        'margin': max(0, margin),
+        'bounds': bounds,
+    }
+
+# Portal/PVS settings
+PORTAL_PROBE_DISTANCE = 0.1   # Blender units either side of a portal used to find its rooms
+PORTAL_SAMPLE_GROW = 0.05     # Portals are grown by this fraction for the line-of-sight samples
+PORTAL_MAX_CHAIN = 8          # Longest portal chain the PVS follows
+PORTAL_MAX_ROOMS = 32         # Room masks are 32-bit (one bit per sub-mesh)
+
+def is_portal(obj):
+    """Portal marker planes (never exported as geometry)"""
+    return obj.type == 'MESH' and ("ps1_portal" in obj or obj.name.lower().startswith("portal"))
+
+def get_room_bounds(obj):
+    """World-space AABB of a room mesh as (min, max) Vectors"""
+    corners = [obj.matrix_world @ v.co for v in obj.data.vertices]
+    lo = mathutils.Vector((min(c.x for c in corners), min(c.y for c in corners), min(c.z for c in corners)))
+    hi = mathutils.Vector((max(c.x for c in corners), max(c.y for c in corners), max(c.z for c in corners)))
+    return lo, hi
+
+def find_room(point, room_bounds):
+    """Smallest room whose bounds contain point, or -1"""
+    best, best_volume = -1, None
+    for i, (lo, hi) in enumerate(room_bounds):
+        if all(lo[a] - 1e-4 <= point[a] <= hi[a] + 1e-4 for a in range(3)):
+            size = hi - lo
+            volume = size.x * size.y * size.z
+            if best_volume is None or volume < best_volume:
+                best, best_volume = i, volume
+    return best
+
+def get_portal_shape(obj):
+    """World-space corners (the first face's first four, in loop order), centre and unit normal of a portal plane
+    Vertex index order is not winding order, and would give a bow-tie"""
+    vertices = obj.data.vertices
+    corners = [obj.matrix_world @ vertices[i].co for i in obj.data.polygons[0].vertices][:4]
+    center = sum(corners, mathutils.Vector()) / len(corners)
+    normal = (corners[1] - corners[0]).cross(corners[2] - corners[0]).normalized()
+    return corners, center, normal
+
+def get_portal_samples(corners, center):
+    """Points spread over a (slightly grown) portal for line-of-sight tests"""
+    grown = [center + (c - center) * (1 + PORTAL_SAMPLE_GROW) for c in corners]
+    samples = [center] + grown
+    for i in range(len(grown)):
+        samples.append((grown[i] + grown[(i + 1) % len(grown)]) / 2)
+    return samples
+
+def segment_crosses_portal(a, b, portal):
+    """Does segment a-b pass through the (grown) portal polygon?"""
+    corners, center, normal = portal
+    da = (a - center).dot(normal)
+    db = (b - center).dot(normal)
+    if da * db > 0 or da == db:
+        return False
+    hit = a + (b - a) * (da / (da - db))
+    
+    # Inside the convex polygon: same side of every edge (with the grow margin)
+    grown = [center + (c - center) * (1 + PORTAL_SAMPLE_GROW) for c in corners]
+    sign = 0
+    for i in range(len(grown)):
+        edge = grown[(i + 1) % len(grown)] - grown[i]
+        side = edge.cross(hit - grown[i]).dot(normal)
+        if side != 0:
+            if sign and (side > 0) != (sign > 0):
+                return False
+            sign = side
+    return True
+
+def build_pvs(room_count, portals):
+    """Potentially visible rooms per room via portal chains with sampled line of sight
+    portals: list of (room_a, room_b, shape)"""
+    adjacency = [[] for _ in range(room_count)]
+    for index, (room_a, room_b, shape) in enumerate(portals):
+        adjacency[room_a].append((index, room_b))
+        adjacency[room_b].append((index, room_a))
+    
+    samples = [get_portal_samples(shape[0], shape[1]) for _, _, shape in portals]
+    
+    def chain_visible(chain):
+        # Some line from the first portal to the last crosses every portal between
+        if len(chain) <= 2:
+            return True
+        for a in samples[chain[0]]:
+            for b in samples[chain[-1]]:
+                if all(segment_crosses_portal(a, b, portals[p][2]) for p in chain[1:-1]):
+                    return True
+        return False
+    
+    pvs = []
+    for start in range(room_count):
+        visible = {start}
+        stack = [(start, [], {start})]
+        while stack:
+            room, chain, path = stack.pop()
+            if len(chain) >= PORTAL_MAX_CHAIN:
+                continue
+            for portal, other in adjacency[room]:
+                if other in path:
+                    continue
+                next_chain = chain + [portal]
+                if chain_visible(next_chain):
+                    visible.add(other)
+                    stack.append((other, next_chain, path | {other}))
+        pvs.append(visible)
+    return pvs
+
+# Collision settings
+COLLISION_MIN_CELL_SHIFT = 8    # Spatial hash cells between 256 and 16384 PS1 units
+COLLISION_MAX_CELL_SHIFT = 14
+COLLISION_MAX_TRIS = 2048       # collision.h default capacity (can be raised with -DCOLLISION_MAX_TRIS)
+COLLISION_MAX_VERTICES = 65535  # Triangles index vertices with unsigned shorts
+
+def is_collision_object(obj):
+    """Collision-only meshes (never exported as render geometry)"""
+    return obj.type == 'MESH' and ("ps1_collision" in obj or obj.name.lower().startswith(("collision", "col_")))
+
+def is_collision_slot(mesh, slot):
+    """Material slots whose material name contains 'collision' are collision-only"""
+    if slot >= len(mesh.materials):
+        return False
+    mat = mesh.materials[slot]
+    return mat is not None and "collision" in mat.name.lower()
+
+def is_collision_material(mesh, poly):
+    return is_collision_slot(mesh, poly.material_index)
+
+def get_collision_cell_shift(vertices, tris):
+    """Hash cell size (as a shift) of about twice the average triangle extent"""
+    if not tris:
+        return COLLISION_MIN_CELL_SHIFT
+    total = 0
+    for tri in tris:
+        xs = [vertices[i][0] for i in tri]
+        zs = [vertices[i][2] for i in tri]
+        total += max(max(xs) - min(xs), max(zs) - min(zs))
+    extent = max(1, 2 * total // len(tris))
+    shift = extent.bit_length()
+    return max(COLLISION_MIN_CELL_SHIFT, min(COLLISION_MAX_CELL_SHIFT, shift))
+
+def get_action_fcurves(action):
+    """F-curves of an action, including Blender 4.4+ layered actions"""
+    fcurves = list(getattr(action, 'fcurves', None) or [])
+    seen = {(fc.data_path, fc.array_index) for fc in fcurves}
+    for layer in getattr(action, 'layers', None) or []:
+        for strip in layer.strips:
+            for channelbag in getattr(strip, 'channelbags', None) or []:
+                for fc in channelbag.fcurves:
+                    if (fc.data_path, fc.array_index) not in seen:
+                        seen.add((fc.data_path, fc.array_index))
+                        fcurves.append(fc)
+    return fcurves
+
+def get_action_data_paths(action):
+    """Data paths animated by an action"""
+    return {fc.data_path for fc in get_action_fcurves(action)}
+
+def get_object_actions(obj):
+    """Actions assigned to an object directly or through its NLA strips"""
+    actions = set()
+    if obj.animation_data:
+        if obj.animation_data.action:
+            actions.add(obj.animation_data.action)
+        for track in obj.animation_data.nla_tracks:
+            actions.update(strip.action for strip in track.strips if strip.action)
+    return actions
+
+def resolves_on(obj, data_path):
+    try:
+        obj.path_resolve(data_path)
+        return True
+    except (ValueError, AttributeError):
+        return False
+
+def is_rig_action(action, mesh_objects, armature_objects):
+    """Does this action animate the exported rig?
+    Actions already used by an exported object (directly or in the NLA) always
+    count. Otherwise a pose action must drive a bone of an exported armature,
+    and an object-level action is only taken when the meshes are themselves
+    animated objects."""
+    if getattr(action, 'id_root', 'OBJECT') not in ('OBJECT', ''):
+        return False  # Shape key, material, camera data... actions
+    
+    targets = list(mesh_objects) + list(armature_objects)
+    if any(action in get_object_actions(obj) for obj in targets):
+        return True
+    
+    paths = get_action_data_paths(action)
+    if not paths:
+        return False
+    
+    pose_paths = [path for path in paths if path.startswith('pose.bones[')]
+    if pose_paths:
+        return any(resolves_on(armature, path) for armature in armature_objects for path in pose_paths)
+    
+    animated_meshes = [obj for obj in mesh_objects if obj.animation_data]
+    return any(all(resolves_on(obj, path) for path in paths) for obj in animated_meshes)
+
+def matches_action_patterns(name, include, exclude):
+    """Comma-separated fnmatch patterns; an empty include list matches everything"""
+    include = [p.strip() for p in include.split(',') if p.strip()]
+    exclude = [p.strip() for p in exclude.split(',') if p.strip()]
+    if include and not any(fnmatch.fnmatchcase(name, p) for p in include):
+        return False
+    return not any(fnmatch.fnmatchcase(name, p) for p in exclude)
+
+class AnimationState:
+    """Restores the scene frame and the meshes' and armatures' assigned actions
+    after baking has switched them"""
+    
+    def __init__(self, mesh_objects, armature_objects):
+        self.objects = [obj for obj in list(mesh_objects) + list(armature_objects) if obj.animation_data]
+    
+    def __enter__(self):
+        self.frame = bpy.context.scene.frame_current
+        self.actions = [(obj, obj.animation_data.action) for obj in self.objects]
+        return self
+    
+    def __exit__(self, *exc):
+        bpy.context.scene.frame_set(self.frame)
+        for obj, action in self.actions:
+            if obj.animation_data:
+                obj.animation_data.action = action
+
+# Incremental export cache
+EXPORT_CACHE_VERSION = 3  # Bumped whenever the same scene would export different bytes
+
+# Options that change no header's contents, so they are left out of the cache keys
+CACHE_IGNORED_OPTIONS = {'use_export_cache', 'write_stats_report', 'texture_depth',
+                         'budget_ram_kb', 'budget_vram_kb', 'budget_packet_kb'}
+
+def hash_array(hasher, array):
+    if array is not None:
+        hasher.update(np.ascontiguousarray(array).tobytes())
+
+def hash_mesh_objects(hasher, mesh_objects, meshes=None):
+    """Everything export_model reads: transforms, geometry, UVs, colours and material slots
+    meshes, when given, are the evaluated copies to hash in place of each object's data"""
+    for obj, mesh in zip(mesh_objects, meshes or [obj.data for obj in mesh_objects]):
+        hasher.update(obj.name.encode())
+        hash_array(hasher, np.array(obj.matrix_world, dtype=np.float32))
+        arrays = read_mesh_arrays(mesh)
+        for key in sorted(arrays):
+            hash_array(hasher, arrays[key])
+        colors, color_domain = get_vertex_colors(mesh)
+        hasher.update(str(color_domain).encode())
+        hash_array(hasher, colors)
+        for mat in mesh.materials:
+            props = get_material_properties(mat, False, True, True)
+            hasher.update(repr((mat.name if mat else None, sorted(props.items()))).encode())
+
+def hash_rig(hasher, mesh_objects, armature_objects):
+    """Deformation inputs shared by every action: modifiers, weights and bone rest poses"""
+    for obj in mesh_objects:
+        for modifier in obj.modifiers:
+            target = getattr(modifier, 'object', None)
+            hasher.update(repr((modifier.name, modifier.type, modifier.show_viewport, target.name if target else None)).encode())
+        hasher.update(repr([group.name for group in obj.vertex_groups]).encode())
+        weights = [(v.index, g.group, round(g.weight, 6)) for v in obj.data.vertices for g in v.groups]
+        hasher.update(repr(weights).encode())
+    for armature in armature_objects:
+        hasher.update(armature.name.encode())
+        hash_array(hasher, np.array(armature.matrix_world, dtype=np.float32))
+        for bone in armature.data.bones:
+            hasher.update(bone.name.encode())
+            hash_array(hasher, np.array(bone.matrix_local, dtype=np.float32))
+
+def hash_action(hasher, action):
+    """Keyframes, handles and interpolation of every f-curve"""
+    hasher.update(repr((action.name, tuple(action.frame_range))).encode())
+    for fc in sorted(get_action_fcurves(action), key=lambda fc: (fc.data_path, fc.array_index)):
+        count = len(fc.keyframe_points)
+        hasher.update(repr((fc.data_path, fc.array_index, fc.extrapolation, len(fc.modifiers), fc.mute)).encode())
+        for prop in ('co', 'handle_left', 'handle_right'):
+            values = np.empty(count * 2, dtype=np.float32)
+            fc.keyframe_points.foreach_get(prop, values)
+            hash_array(hasher, values)
+        interpolation = [kp.interpolation for kp in fc.keyframe_points]
+        hasher.update(repr(interpolation).encode())
+
+class ExportCache:
+    """Sidecar file recording the input hash each header was generated from.
+    Headers whose inputs hash the same as last time are not regenerated; their
+    stats are kept here so the report still covers them."""
+    
+    def __init__(self, export_dir, base_name, options):
+        self.filepath = os.path.join(export_dir, f".{base_name}.ps1cache")
+        self.options = options
+        self.entries = {}
+        self.stats = {}
+        try:
+            with open(self.filepath, 'r', encoding='utf-8') as f:
+                data = json.load(f)
+            if data.get('version') == EXPORT_CACHE_VERSION:
+                self.entries = data.get('entries', {})
+                self.stats = data.get('stats', {})
+        except (OSError, ValueError):
+            pass
+    
+    def key(self, *parts):
+        """Hash of the export options and the given pre-hashed inputs"""
+        hasher = hashlib.sha1(self.options.encode())
+        for part in parts:
+            hasher.update(part.encode())
+        return hasher.hexdigest()
+    
+    def is_fresh(self, filepath, key):
+        name = os.path.basename(filepath)
+        return self.entries.get(name) == key and name in self.stats and os.path.exists(filepath)
+    
+    def store(self, filepath, key, stats):
+        self.entries[os.path.basename(filepath)] = key
+        self.stats[os.path.basename(filepath)] = stats
+    
+    def get_stats(self, filepath):
+        return self.stats[os.path.basename(filepath)]
+    
+    def save(self):
+        with open(self.filepath, 'w', encoding='utf-8') as f:
+            json.dump({'version': EXPORT_CACHE_VERSION, 'entries': self.entries, 'stats': self.stats},
+                      f, indent=1, sort_keys=True)
+
+def is_scene_instance(obj):
+    """Objects placed as instances of another exported model"""
+    if "ps1_model" in obj:
+        return True
+    return obj.type == 'EMPTY' and obj.instance_type == 'COLLECTION' and obj.instance_collection is not None
+
+def get_scene_instance_model(obj):
+    """Model name an instance refers to (its header prefix)"""
+    if "ps1_model" in obj:
+        name = str(obj["ps1_model"])
+    else:
+        name = obj.instance_collection.name
+    return name.lower().replace('-', '_').replace(' ', '_')
+
+def get_scene_instance_transform(obj, convert_to_z_up):
+    """World transform as PS1 position, rotation (4096 = 360 degrees) and scale (4096 = 1.0)
+    The runtime rebuilds the instance as translate * rotate * scale, which cannot
+    express the shear a rotated child of a non-uniformly scaled parent picks up,
+    so such instances are rejected rather than exported distorted"""
+    location, rotation, scale = obj.matrix_world.decompose()
+    
+    recomposed = mathutils.Matrix.LocRotScale(location, rotation, scale)
+    tolerance = 1e-4 * max(1.0, max(abs(c) for c in scale))
+    if any(abs(a - b) > tolerance for row_a, row_b in zip(recomposed, obj.matrix_world) for a, b in zip(row_a, row_b)):
+        raise ExportError(f"Instance '{obj.name}' is sheared (rotated under a non-uniformly scaled parent); "
+                          f"apply the parent's scale or unparent it")
+    
+    # Change of basis: R' = P * R * P^-1, P maps (x, y, z) to (x, -z, y)
+    # P * S * P^-1 is S with its Y and Z factors swapped whatever R is,
+    # since the scale is applied in the object's own axes before rotating
+    rot = rotation.to_matrix()
+    if convert_to_z_up:
+        basis = mathutils.Matrix(((1, 0, 0), (0, 0, -1), (0, 1, 0)))
+        rot = basis @ rot @ basis.transposed()
+        scale = (scale[0], scale[2], scale[1])
+    
+    # RotMatrix composes Rx * Ry * Rz, which is Blender's ZYX euler order
+    euler = rot.to_euler('ZYX')
+    angles = [int(round(a * 4096 / (2 * math.pi))) for a in (euler.x, euler.y, euler.z)]
+    
+    coord = convert_coordinate(location, convert_to_z_up)
+    return (
+        tuple(int(c * PS1_SCALE_FACTOR) for c in coord),
+        tuple(angles),
+        tuple(int(round(c * 4096)) for c in scale),
+    )
+
+def build_prim_template(face, flags, uvs, vertex_colors):
+    """Build the GPU packet words for one face, matching what model.c would write.
+    XY, tpage and clut are left zero: XY is patched every frame, tpage/clut once at init.
+    Lit faces get neutral grey which the renderer replaces with lit colours.
+    """
+    is_textured = bool(flags & (1 << 1))
+    is_smooth = bool(flags & (1 << 2))
+    code, layout = PRIM_TEMPLATE_LAYOUTS[(is_textured, is_smooth, not face['is_tri'])]
+    if flags & (1 << 4):
+        code |= 0x02  # Semi-transparent
+    
+    # Unlit faces bake their final colour; vertex colours are indexed by vertex like the renderer
+    colors = []
+    for v in face['vertices']:
+        if (flags & (1 << 0)) and (flags & (1 << 3)) and v < len(vertex_colors):
+            r, g, b = vertex_colors[v]
+            colors.append((r, g, b))
+        else:
+            colors.append((128, 128, 128))
+    
+    words = []
+    for slot in layout:
+        if slot == 'tag':
+            words.append((len(layout) - 1) << 24)
+        elif slot.startswith('rgb'):
+            r, g, b = colors[int(slot[3])]
+            words.append(((code if slot == 'rgb0' else 0) << 24) | (b << 16) | (g << 8) | r)
+        elif slot.startswith('uv'):
+            u, v = uvs[face['uvs'][int(slot[2])]] if uvs else (0, 0)
+            words.append(((v & 0xFF) << 8) | (u & 0xFF))
+        else:
+            words.append(0)
+    return words
+
+class ExportError(Exception):
+    """Export cannot go ahead (reported to the user instead of a traceback)"""
+
+class PS1Exporter:
+    """Export logic shared by the File > Export operator and the command line.
+    Options are read from attributes named after the operator's properties."""
+    
+    def export_scene(self, export_dir, base_name):
+        """Export every header for the open .blend into export_dir
+        Returns informational notes; raises ExportError when nothing can be exported"""
+        notes = []
+        self.export_notes = notes
         
+        # Meshes tagged with ps1_model stand in for instances of another
+        # model and only appear in the scene layout; portals are markers only
+        # and collision meshes go to their own header
         mesh_objects = sorted(
-            [obj for obj in bpy.data.objects if obj.type == 'MESH'],
+            [obj for obj in bpy.data.objects
+             if obj.type == 'MESH' and not is_scene_instance(obj) and not is_portal(obj)
+             and not (self.export_collision and is_collision_object(obj))],
             key=lambda obj: obj.name
         )
         
         if not mesh_objects:
-            show_message("No mesh objects found in scene!", "Error", 'ERROR')
-            return {'CANCELLED'}
+            raise ExportError("No mesh objects found in scene!")
+        if len(mesh_objects) > MODEL_MAX_MESHES:
+            raise ExportError(f"The scene has {len(mesh_objects)} mesh objects, but sub-mesh visibility masks are "
+                              f"32-bit and hold at most {MODEL_MAX_MESHES}; join some meshes")
         
-        needs_triangulation = False
-        for obj in mesh_objects:
-            for poly in obj.data.polygons:
-                if len(poly.vertices) > 4:
-                    needs_triangulation = True
-                    mesh_triangulate(obj)
-                    break
+        # Everything below reads evaluated copies, never the objects' own data
+        meshes, split = build_export_meshes(mesh_objects)
+        if split:
+            notes.append("Some faces had more than 4 vertices and were triangulated.")
+        
+        self.export_meshes = dict(zip((obj.name for obj in mesh_objects), meshes))
+        try:
+            report = self.write_headers(export_dir, base_name, mesh_objects, meshes)
+        finally:
+            self.export_meshes = {}
+            for mesh in meshes:
+                bpy.data.meshes.remove(mesh)
+        
+        totals = report['totals']
+        notes.append(f"RAM {totals['ram_bytes'] / 1024:.1f} KB, VRAM {totals['vram_bytes'] / 1024:.1f} KB, "
+                     f"{totals['gpu_packet_bytes_per_frame'] / 1024:.1f} KB of GPU packets per frame")
+        if report['over_budget']:
+            raise ExportError("Over budget: " + "; ".join(report['over_budget']))
+        return notes
+    
+    def add_note(self, message):
+        """Report something worth knowing about the export once it has finished"""
+        if not hasattr(self, 'export_notes'):
+            self.export_notes = []
+        self.export_notes.append(message)
+    
+    def open_header(self, filepath):
+        """HeaderWriter for one exported header; during write_headers it is staged
+        so nothing is replaced until the export is within its budgets"""
+        return HeaderWriter(filepath, getattr(self, 'staged_headers', None))
+    
+    def get_export_mesh(self, obj):
+        """The evaluated copy built by export_scene, or the object's own mesh outside an export"""
+        return getattr(self, 'export_meshes', {}).get(obj.name, obj.data)
+    
+    def write_headers(self, export_dir, base_name, mesh_objects, meshes):
+        """Write each enabled header from the evaluated meshes, skipping the ones still up to date
+        Returns the stats report covering every header"""
+        # Headers whose inputs hash the same as last export are left alone
+        cache = ExportCache(export_dir, base_name, self.get_options_key())
+        if not self.use_export_cache:
+            cache.entries = {}
+        
+        # New headers are staged until the totals are known, so an over-budget
+        # export leaves the previous headers and the cache as they were
+        self.staged_headers = []
+        try:
+            header_stats = self.write_header_files(cache, export_dir, base_name, mesh_objects, meshes)
+            report = build_stats_report(base_name, header_stats, int(self.texture_depth))
+            report['over_budget'] = self.check_budgets(report['totals'])
+        except BaseException:
+            for header in self.staged_headers:
+                header.discard()
+            raise
+        finally:
+            staged, self.staged_headers = self.staged_headers, None
+        
+        if report['over_budget']:
+            for header in staged:
+                header.discard()
+        else:
+            for header in staged:
+                header.commit()
+            cache.save()
+        
+        # Written either way; over-budget exports still leave a report to inspect
+        if self.write_stats_report:
+            with HeaderWriter(os.path.join(export_dir, f"{base_name}-stats.json")) as out:
+                out.write(json.dumps(report, indent=2, sort_keys=True) + "\n")
+        return report
+    
+    def write_header_files(self, cache, export_dir, base_name, mesh_objects, meshes):
+        """Write every enabled header whose cache entry is stale
+        Returns the stats of every header, keyed by file name"""
+        hasher = hashlib.sha1()
+        hash_mesh_objects(hasher, mesh_objects, meshes)
+        mesh_hash = hasher.hexdigest()
         
-        if needs_triangulation:
-            show_message("Some faces had more than 4 vertices and were triangulated.", "Info", 'INFO')
+        # Welded vertices must also move together in every frame, so the
+        # actions are baked before the model; the model then depends on every
+        # action and nothing is skipped
+        baked = None
+        animate = self.export_animations and len(bpy.data.actions) > 0
+        if self.weld_vertices != 'NONE' and animate:
+            cache.entries = {}
+            baked = self.bake_actions(mesh_objects, *self.get_export_actions(mesh_objects))
         
         model_filepath = os.path.join(export_dir, base_name + ".h")
-        self.export_model(mesh_objects, model_filepath, base_name)
+        model_key = cache.key("model", mesh_hash)
+        if not cache.is_fresh(model_filepath, model_key):
+            cache.store(model_filepath, model_key, self.export_model(mesh_objects, model_filepath, base_name, baked))
+        header_stats = {os.path.basename(model_filepath): cache.get_stats(model_filepath)}
         
-        if self.export_animations and len(bpy.data.actions) > 0:
-            self.export_all_animations(mesh_objects, export_dir, base_name)
+        if animate:
+            header_stats.update(self.export_all_animations(mesh_objects, export_dir, base_name, cache, mesh_hash, baked))
         
-        show_message(f"Export complete! Files saved to {export_dir}", "Success", 'INFO')
-        return {'FINISHED'}
+        if self.export_portals:
+            portals_filepath = os.path.join(export_dir, f"{base_name}-portals.h")
+            header_stats[os.path.basename(portals_filepath)] = self.write_portals(portals_filepath, base_name, mesh_objects)
+        
+        if self.export_collision:
+            collision_filepath = os.path.join(export_dir, f"{base_name}-collision.h")
+            hasher = hashlib.sha1()
+            hash_mesh_objects(hasher, [obj for obj in bpy.data.objects if is_collision_object(obj)])
+            collision_key = cache.key("collision", mesh_hash, hasher.hexdigest())
+            if not cache.is_fresh(collision_filepath, collision_key):
+                cache.store(collision_filepath, collision_key, self.write_collision(collision_filepath, base_name, mesh_objects))
+            header_stats[os.path.basename(collision_filepath)] = cache.get_stats(collision_filepath)
+            tri_count = cache.get_stats(collision_filepath).get('collision_tris', 0)
+            if tri_count == 0:
+                self.add_note("No collision triangles survived quantisation; the collision header holds "
+                              "one placeholder triangle and a TRI_COUNT of 0")
+            elif tri_count > COLLISION_MAX_TRIS:
+                self.add_note(f"Collision mesh has {tri_count} triangles; initCollisionMesh only hashes "
+                              f"{COLLISION_MAX_TRIS} unless built with a larger -DCOLLISION_MAX_TRIS")
+        
+        if self.export_scene_layout:
+            scene_filepath = os.path.join(export_dir, f"{base_name}-scene.h")
+            header_stats[os.path.basename(scene_filepath)] = self.write_scene_layout(scene_filepath, base_name)
+        return header_stats
+    
+    def check_budgets(self, totals):
+        """Descriptions of every total over its budget (a budget of 0 is not checked)"""
+        over = []
+        for label, key, budget_kb in (("RAM", 'ram_bytes', self.budget_ram_kb),
+                                      ("VRAM", 'vram_bytes', self.budget_vram_kb),
+                                      ("GPU packets per frame", 'gpu_packet_bytes_per_frame', self.budget_packet_kb)):
+            if budget_kb and totals[key] > budget_kb * 1024:
+                over.append(f"{label} {totals[key] / 1024:.1f} KB > {budget_kb} KB")
+        return over
     
-    def export_model(self, mesh_objects, filepath, base_name):
-        """Export main model geometry to C header file"""
-        all_vertices = []
-        all_normals = []  # Vertex normals for lighting
-        all_uvs = []
+    def get_options_key(self):
+        """Every export option plus the exporter version, as a stable string"""
+        names = sorted(name for name in get_option_defaults() if name not in CACHE_IGNORED_OPTIONS)
+        options = [(name, getattr(self, name)) for name in names]
+        return repr((EXPORT_CACHE_VERSION, bl_info['version'], options))
+    
+    def export_model(self, mesh_objects, filepath, base_name, baked=None):
+        """Export main model geometry to C header file
+        baked holds the actions' frames (from bake_actions) when vertices are welded;
+        they are remapped in place to the welded vertices"""
+        vertex_blocks = []
+        normal_blocks = []
+        uv_blocks = []
+        color_blocks = []
         all_faces = []
         all_materials = []
-        all_vertex_colors = []
         texture_names = []  # Ordered list of unique texture names
         texture_name_to_idx = {}  # Maps texture name to index
         has_any_vertex_colors = False
@@ -330,172 +1079,161 @@ class ExportPS1(Operator, ExportHelper):
         
         # Combine all mesh objects
         for mesh_index, obj in enumerate(mesh_objects):
-            mesh = obj.data
+            mesh = self.get_export_mesh(obj)
+            arrays = read_mesh_arrays(mesh)
             
-            # Get the world matrix to apply object transforms (location, rotation, scale)
-            world_matrix = obj.matrix_world
+            # World transform (location, rotation, scale) applied to the whole mesh at once
+            world_matrix = np.array(obj.matrix_world, dtype=np.float32)
             
-            # Get vertex colors and domain for this mesh
-            vert_colors, color_domain = get_vertex_colors(mesh)
+            # Vertices: world space, PS1 axes, then fixed point (truncated like int())
+            coords = convert_coordinates(transform_points(world_matrix, arrays['co']).astype(np.float64), self.convert_coords)
+            vertex_blocks.append(np.trunc(coords * PS1_SCALE_FACTOR).astype(np.int64))
             
-            if vert_colors and color_domain:
+            # Vertex normals: rotated, normalised, ONE = 4096
+            normals = normalize_points(transform_points(world_matrix[:3, :3], arrays['normal'])).astype(np.float64)
+            normal_blocks.append(np.trunc(convert_coordinates(normals, self.convert_coords) * 4096).astype(np.int64))
+            
+            # Vertex colours are written per vertex or per corner, matching their domain
+            colors, color_domain = get_vertex_colors(mesh)
+            if colors is not None:
                 has_any_vertex_colors = True
+                if color_domain in ('VERTEX', 'CORNER'):
+                    color_blocks.append(np.trunc(colors * 255).astype(np.int64))
             
-            # Extract vertices (apply world transform, then scale to PS1 fixed-point integers)
-            for vert_idx, vert in enumerate(mesh.vertices):
-                # Apply object's world transform (includes scale, rotation, location)
-                world_coord = world_matrix @ vert.co
-                coord = convert_coordinate(world_coord, self.convert_coords)
-                all_vertices.append({
-                    'x': int(coord[0] * PS1_SCALE_FACTOR),
-                    'y': int(coord[1] * PS1_SCALE_FACTOR),
-                    'z': int(coord[2] * PS1_SCALE_FACTOR)
-                })
-                
-                # Extract vertex normal (apply rotation, normalize to ONE=4096)
-                world_normal = (world_matrix.to_3x3() @ vert.normal).normalized()
-                normal_coord = convert_coordinate(world_normal, self.convert_coords)
-                all_normals.append({
-                    'x': int(normal_coord[0] * 4096),
-                    'y': int(normal_coord[1] * 4096),
-                    'z': int(normal_coord[2] * 4096)
-                })
-                
-                # Extract vertex color for this vertex (if domain is VERTEX)
-                if vert_colors and color_domain == 'VERTEX':
-                    if vert_idx < len(vert_colors):
-                        color = vert_colors[vert_idx]
-                        all_vertex_colors.append({
-                            'r': int(color.r * 255),
-                            'g': int(color.g * 255),
-                            'b': int(color.b * 255)
-                        })
-                    else:
-                        # Default to white if index out of range
-                        all_vertex_colors.append({'r': 255, 'g': 255, 'b': 255})
-            
-            # If color domain is CORNER, we need to extract per-loop colors
-            if vert_colors and color_domain == 'CORNER':
-                for loop_idx in range(len(mesh.loops)):
-                    if loop_idx < len(vert_colors):
-                        color = vert_colors[loop_idx]
-                        all_vertex_colors.append({
-                            'r': int(color.r * 255),
-                            'g': int(color.g * 255),
-                            'b': int(color.b * 255)
-                        })
-                    else:
-                        all_vertex_colors.append({'r': 255, 'g': 255, 'b': 255})
-            
-            # Get UV layer reference
-            uv_layer = mesh.uv_layers.active.data if mesh.uv_layers.active else None
-            
-            # Extract faces and materials
-            for poly_idx, poly in enumerate(mesh.polygons):
-                mat_props = detect_material_properties(mesh, poly, self.enable_unlit, self.enable_specular, self.enable_metallic)
-                
-                # Assign texture index
-                if mat_props['texture_name']:
-                    tex_name = mat_props['texture_name']
+            # Material properties are resolved once per slot; the extra
+            # last entry stands for faces without a material
+            slot_count = len(mesh.materials)
+            slot_props = [get_material_properties(mesh.materials[i], self.enable_unlit, self.enable_specular, self.enable_metallic)
+                          for i in range(slot_count)]
+            slot_props.append(get_material_properties(None, self.enable_unlit, self.enable_specular, self.enable_metallic))
+            slots = np.where(arrays['material_index'] < slot_count, arrays['material_index'], slot_count)
+            
+            # Only tris and quads are exported
+            keep = (arrays['loop_total'] == 3) | (arrays['loop_total'] == 4)
+            if self.export_collision:
+                slot_is_collision = np.array([is_collision_slot(mesh, i) for i in range(slot_count + 1)])
+                keep &= ~slot_is_collision[slots]  # Collision-only faces
+            face_indices = np.nonzero(keep)[0]
+            
+            # Texture indices in order of first use
+            kept_slots = slots[face_indices]
+            _, first_use = np.unique(kept_slots, return_index=True)
+            for slot in kept_slots[np.sort(first_use)].tolist():
+                tex_name = slot_props[slot]['texture_name']
+                if tex_name:
                     if tex_name not in texture_name_to_idx:
                         texture_name_to_idx[tex_name] = len(texture_names)
                         texture_names.append(tex_name)
-                    mat_props['texture_index'] = texture_name_to_idx[tex_name]
-                
-                # Get texture dimensions for THIS polygon (from its material)
-                tex_width = mat_props['texture_width']
-                tex_height = mat_props['texture_height']
-                
-                # Get vertex indices with proper winding order
-                if len(poly.vertices) == 3:
-                    # Triangle: [0, 2, 1]
-                    vert_indices = [
-                        mesh.loops[poly.loop_start].vertex_index + vertex_offset,
-                        mesh.loops[poly.loop_start + 2].vertex_index + vertex_offset,
-                        mesh.loops[poly.loop_start + 1].vertex_index + vertex_offset
-                    ]
-                    
-                    # Extract UVs for this triangle with THIS polygon's texture dimensions
-                    uv_indices = [0, 0, 0]
-                    if uv_layer:
-                        # UV 0
-                        uv = uv_layer[poly.loop_start].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        # UV 2
-                        uv = uv_layer[poly.loop_start + 2].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        # UV 1
-                        uv = uv_layer[poly.loop_start + 1].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        uv_indices = [uv_offset, uv_offset + 1, uv_offset + 2]
-                        uv_offset += 3
-                    
-                elif len(poly.vertices) == 4:
-                    # Quad: [3, 2, 0, 1]
-                    vert_indices = [
-                        mesh.loops[poly.loop_start + 3].vertex_index + vertex_offset,
-                        mesh.loops[poly.loop_start + 2].vertex_index + vertex_offset,
-                        mesh.loops[poly.loop_start].vertex_index + vertex_offset,
-                        mesh.loops[poly.loop_start + 1].vertex_index + vertex_offset
-                    ]
-                    
-                    # Extract UVs for this quad with THIS polygon's texture dimensions
-                    uv_indices = [0, 0, 0, 0]
-                    if uv_layer:
-                        # UV 3
-                        uv = uv_layer[poly.loop_start + 3].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        # UV 2
-                        uv = uv_layer[poly.loop_start + 2].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        # UV 0
-                        uv = uv_layer[poly.loop_start].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        # UV 1
-                        uv = uv_layer[poly.loop_start + 1].uv
-                        all_uvs.append({
-                            'u': round(uv.x * tex_width),
-                            'v': round(tex_height - (uv.y * tex_height))
-                        })
-                        uv_indices = [uv_offset, uv_offset + 1, uv_offset + 2, uv_offset + 3]
-                        uv_offset += 4
+                    slot_props[slot]['texture_index'] = texture_name_to_idx[tex_name]
+            
+            # Corners of every kept face, in export winding order
+            totals = arrays['loop_total'][face_indices]
+            face_ends = np.cumsum(totals)
+            corner = np.arange(face_ends[-1] if len(face_ends) else 0) - np.repeat(face_ends - totals, totals)
+            loops = np.repeat(arrays['loop_start'][face_indices], totals) + FACE_LOOP_ORDER[np.repeat(totals, totals), corner]
+            face_verts = (arrays['loop_vertex'][loops] + vertex_offset).tolist()
+            
+            # UVs scaled by each face's own texture dimensions
+            uv_count = 0
+            if arrays['uv'] is not None:
+                widths = np.array([p['texture_width'] for p in slot_props], dtype=np.float64)[kept_slots]
+                heights = np.array([p['texture_height'] for p in slot_props], dtype=np.float64)[kept_slots]
+                width = np.repeat(widths, totals)
+                height = np.repeat(heights, totals)
+                uv = arrays['uv'][loops]
+                uv_blocks.append(np.stack((np.round(uv[:, 0] * width), np.round(height - uv[:, 1] * height)), axis=1).astype(np.int64))
+                uv_count = len(loops)
+            
+            has_colors = get_face_color_mask(colors, color_domain, arrays)[face_indices].tolist()
+            smooth = arrays['use_smooth'][face_indices].tolist()
+            
+            start = 0
+            for f, (slot, total) in enumerate(zip(kept_slots.tolist(), totals.tolist())):
+                if uv_count:
+                    uv_indices = list(range(uv_offset + start, uv_offset + start + total))
                 else:
-                    continue
+                    uv_indices = [0] * total
                 
                 all_faces.append({
-                    'vertices': vert_indices,
+                    'vertices': face_verts[start:start + total],
                     'uvs': uv_indices,
-                    'is_tri': len(poly.vertices) == 3,
+                    'is_tri': total == 3,
                     'mesh_id': mesh_index,
                     'mesh_name': obj.name
                 })
+                
+                mat_props = dict(slot_props[slot])
+                mat_props['is_smooth'] = smooth[f]
+                mat_props['has_vertex_colors'] = has_colors[f]
                 all_materials.append(mat_props)
+                start += total
             
+            uv_offset += uv_count
             vertex_offset += len(mesh.vertices)
         
+        all_vertices = np.concatenate(vertex_blocks)
+        check_svector_range(all_vertices, "Model vertices")
+        all_normals = np.concatenate(normal_blocks)
+        all_uvs = np.concatenate(uv_blocks) if uv_blocks else np.zeros((0, 2), dtype=np.int64)
+        all_vertex_colors = np.concatenate(color_blocks) if color_blocks else np.zeros((0, 3), dtype=np.int64)
+        
+        if self.weld_vertices != 'NONE':
+            all_vertices, all_normals, all_vertex_colors = self.weld_model(
+                vertex_blocks, all_normals, all_vertex_colors, has_any_vertex_colors, all_faces, baked or {})
+        
+        # Faces are appended object by object, so each mesh's tris and quads
+        # are already contiguous; the per-mesh ranges rely on this ordering
+        mesh_names = [obj.name for obj in mesh_objects]
+        
+        # A spatial grid reorders faces by cell instead (mesh ranges are dropped)
+        grid = None
+        if self.grid_cell_size > 0 and all_faces:
+            grid = build_face_grid(all_vertices.tolist(), all_faces, int(self.grid_cell_size * PS1_SCALE_FACTOR))
+            order = sorted(range(len(all_faces)), key=lambda i: (all_faces[i]['cell'], all_faces[i]['mesh_id']))
+            all_faces = [all_faces[i] for i in order]
+            all_materials = [all_materials[i] for i in order]
+        
         # Write C header file
-        self.write_header_file(filepath, base_name, all_vertices, all_normals, all_uvs, all_faces, all_materials, texture_names, all_vertex_colors, has_any_vertex_colors, self.enable_semi_transparency, self.enable_cutout_transparency)
+        return self.write_header_file(filepath, base_name, all_vertices, all_normals, all_uvs, all_faces, all_materials, texture_names, all_vertex_colors, has_any_vertex_colors, self.enable_semi_transparency, self.enable_cutout_transparency, mesh_names, grid)
+    
+    def weld_model(self, vertex_blocks, normals, vertex_colors, has_vertex_colors, faces, baked):
+        """Merge vertices that match after fixed-point quantisation and drop the ones no face uses
+        Vertices only merge when their normals (so hard edges stay split), their colour as the
+        renderer reads it, their position in every baked frame and, for Within Mesh, their
+        sub-mesh all match too. Face indices and baked frames are remapped in place.
+        Returns the welded vertices, normals and vertex colours"""
+        vertices = np.concatenate(vertex_blocks)
+        key_columns = [vertices, normals]
+        
+        # The renderer indexes colours by vertex, so give every vertex the colour it would read
+        if has_vertex_colors:
+            vertex_colors = np.concatenate((vertex_colors[:len(vertices)],
+                                            np.full((max(0, len(vertices) - len(vertex_colors)), 3), 128, dtype=np.int64)))
+            key_columns.append(vertex_colors)
+        if self.weld_vertices == 'WITHIN_MESH':
+            mesh_ids = np.repeat(np.arange(len(vertex_blocks)), [len(block) for block in vertex_blocks])
+            key_columns.append(mesh_ids[:, None])
+        for _, frames in baked.values():
+            key_columns.append(frames.transpose(1, 0, 2).reshape(len(vertices), -1))
+        
+        used = np.zeros(len(vertices), dtype=bool)
+        for face in faces:
+            used[face['vertices']] = True
+        kept, remap = build_weld_map(key_columns, used)
+        
+        remap = remap.tolist()
+        for face in faces:
+            face['vertices'] = [remap[v] for v in face['vertices']]
+        for name, (frame_start, frames) in baked.items():
+            baked[name] = (frame_start, frames[:, kept])
+        
+        if has_vertex_colors:
+            vertex_colors = vertex_colors[kept]
+        return vertices[kept], normals[kept], vertex_colors
     
-    def write_header_file(self, filepath, base_name, vertices, normals, uvs, faces, materials, texture_names, vertex_colors, has_vertex_colors, enable_semi_transparency, enable_cutout_transparency):
-        """Write C header file"""
+    def write_header_file(self, filepath, base_name, vertices, normals, uvs, faces, materials, texture_names, vertex_colors, has_vertex_colors, enable_semi_transparency, enable_cutout_transparency, mesh_names, grid=None):
+        """Write C header file (vertices, normals, uvs and vertex_colors are integer NumPy arrays)
+        Returns the header's stats"""
         guard_name = base_name.upper().replace('-', '_').replace(' ', '_')
         prefix = base_name.lower().replace('-', '_').replace(' ', '_')
         prefix_upper = prefix.upper()
@@ -514,10 +1252,13 @@ typedef struct {
             includes = """#include <sys/types.h>
 #include <libgte.h>"""
         
-        tri_count = sum(1 for f in faces if f['is_tri'])
-        quad_count = len(faces) - tri_count
+        tri_faces = [f for f in faces if f['is_tri']]
+        quad_faces = [f for f in faces if not f['is_tri']]
+        tri_count = len(tri_faces)
+        quad_count = len(quad_faces)
         
-        content = f"""// PlayStation 1 Model Export
+        with self.open_header(filepath) as out:
+            out.write(f"""// PlayStation 1 Model Export
 // Generated by PS1 Exporter for Blender 4.0
 // Model: {base_name}
 // Coordinate System: {'Z-up (PS1)' if self.convert_coords else 'Y-up (Blender)'}
@@ -536,197 +1277,275 @@ typedef struct {
 
 // Vertices (fixed-point, scaled by {PS1_SCALE_FACTOR})
 SVECTOR {prefix}_vertices[{prefix_upper}_VERTICES_COUNT] = {{
-"""
-        
-        for v in vertices:
-            content += f"    {{ {v['x']}, {v['y']}, {v['z']} }},\n"
-        
-        content += "};\n\n"
-        
-        # Normals (normalized, scaled by 4096 = ONE)
-        content += f"// Normals (for lighting calculations)\n"
-        content += f"SVECTOR {prefix}_normals[{prefix_upper}_VERTICES_COUNT] = {{\n"
-        
-        for n in normals:
-            content += f"    {{ {n['x']}, {n['y']}, {n['z']} }},\n"
-        
-        content += "};\n\n"
-        
-        # Texture defines (prefixed to avoid conflicts)
-        if texture_names:
-            content += "// Texture references\n"
-            content += f"#define {prefix_upper}_TEXTURE_COUNT {len(texture_names)}\n"
-            for i, tex_name in enumerate(sorted(texture_names)):
-                # Clean texture name for C identifier (remove extension, replace invalid chars)
-                clean_name = os.path.splitext(tex_name)[0].upper().replace(' ', '_').replace('-', '_').replace('.', '_')
-                content += f"#define {prefix_upper}_TEXTURE_{i}_NAME \"{tex_name}\"\n"
-                content += f"#define {prefix_upper}_TEXTURE_{clean_name} {i}\n"
-            content += "\n"
-        
-        # UVs
-        if uvs:
-            content += f"// UV Coordinates\n"
-            content += f"SVECTOR {prefix}_uvs[{prefix_upper}_UVS_COUNT] = {{\n"
-            for uv in uvs:
-                content += f"    {{ {uv['u']}, {uv['v']}, 0 }},\n"
-            content += "};\n\n"
-        
-        content += "// Faces\n"
-        tri_count = sum(1 for f in faces if f['is_tri'])
-        quad_count = len(faces) - tri_count
-        
-        if tri_count > 0:
-            content += f"int {prefix}_tri_faces[{tri_count}][3] = {{\n"
-            for face in faces:
-                if face['is_tri']:
-                    v = face['vertices']
-                    content += f"    {{ {v[0]}, {v[1]}, {v[2]} }},\n"
-            content += "};\n\n"
-            
-            if uvs:
-                content += f"int {prefix}_tri_uvs[{tri_count}][3] = {{\n"
-                for face in faces:
-                    if face['is_tri']:
-                        uv = face['uvs']
-                        content += f"    {{ {uv[0]}, {uv[1]}, {uv[2]} }},\n"
-                content += "};\n\n"
-        else:
-            # Export dummy arrays for models with no triangles
-            content += f"int {prefix}_tri_faces[1][3] = {{ {{0, 0, 0}} }};\n"
-            if uvs:
-                content += f"int {prefix}_tri_uvs[1][3] = {{ {{0, 0, 0}} }};\n"
-            content += "\n"
-        
-        if quad_count > 0:
-            content += f"int {prefix}_quad_faces[{quad_count}][4] = {{\n"
-            for face in faces:
-                if not face['is_tri']:
-                    v = face['vertices']
-                    content += f"    {{ {v[0]}, {v[1]}, {v[2]}, {v[3]} }},\n"
-            content += "};\n\n"
-            
-            if uvs:
-                content += f"int {prefix}_quad_uvs[{quad_count}][4] = {{\n"
-                for face in faces:
-                    if not face['is_tri']:
-                        uv = face['uvs']
-                        content += f"    {{ {uv[0]}, {uv[1]}, {uv[2]}, {uv[3]} }},\n"
-                content += "};\n\n"
-        else:
-            # Export dummy arrays for models with no quads
-            content += f"int {prefix}_quad_faces[1][4] = {{ {{0, 0, 0, 0}} }};\n"
-            if uvs:
-                content += f"int {prefix}_quad_uvs[1][4] = {{ {{0, 0, 0, 0}} }};\n"
-            content += "\n"
-        
-        # Material flags: Bit 0: unlit, Bit 1: textured, Bit 2: smooth, Bit 3: vertex_color, Bit 4: alpha, Bit 5: cutout, Bit 6: specular, Bit 7: metallic
-        content += f"unsigned char {prefix}_material_flags[{prefix_upper}_FACES_COUNT] = {{\n"
-        
-        # Write material flags in same order as faces: triangles first, then quads
-        ordered_materials = [mat for mat, face in zip(materials, faces) if face['is_tri']]
-        ordered_materials += [mat for mat, face in zip(materials, faces) if not face['is_tri']]
-        
-        for mat in ordered_materials:
-            flags = 0
-            if not mat['is_lit']:
-                flags |= (1 << 0)
-            if mat['is_textured']:
-                flags |= (1 << 1)
-            if mat['is_smooth']:
-                flags |= (1 << 2)
-            if mat['has_vertex_colors']:
-                flags |= (1 << 3)
-            if mat['has_alpha'] and enable_semi_transparency:
-                flags |= (1 << 4)
-            if mat['has_alpha'] and enable_cutout_transparency:
-                flags |= (1 << 5)
-            if self.enable_specular:
-                flags |= (1 << 6)
-            if self.enable_metallic:
-                flags |= (1 << 7)
-            content += f"    0b{flags:08b},  // "
-            desc = []
-            desc.append("unlit" if not mat['is_lit'] else "lit")
-            if mat['is_textured']:
-                desc.append("textured")
-            desc.append("smooth" if mat['is_smooth'] else "flat")
-            if mat['has_vertex_colors']:
-                desc.append("vertex-colored")
-            if mat['has_alpha']:
-                if enable_semi_transparency:
-                    desc.append("alpha")
-                if enable_cutout_transparency:
-                    desc.append("cutout")
+""")
+            out.rows("    { %d, %d, %d },\n", vertices)
+            out.write("};\n\n")
+            
+            # Normals (normalized, scaled by 4096 = ONE)
+            out.write(f"// Normals (for lighting calculations)\n")
+            out.write(f"SVECTOR {prefix}_normals[{prefix_upper}_VERTICES_COUNT] = {{\n")
+            out.rows("    { %d, %d, %d },\n", normals)
+            out.write("};\n\n")
+            
+            # Texture defines (prefixed to avoid conflicts)
+            if texture_names:
+                out.write("// Texture references\n")
+                out.write(f"#define {prefix_upper}_TEXTURE_COUNT {len(texture_names)}\n")
+                for i, tex_name in enumerate(sorted(texture_names)):
+                    # Clean texture name for C identifier (remove extension, replace invalid chars)
+                    clean_name = os.path.splitext(tex_name)[0].upper().replace(' ', '_').replace('-', '_').replace('.', '_')
+                    out.write(f"#define {prefix_upper}_TEXTURE_{i}_NAME \"{tex_name}\"\n")
+                    out.write(f"#define {prefix_upper}_TEXTURE_{clean_name} {i}\n")
+                out.write("\n")
+            
+            # UVs
+            if len(uvs):
+                out.write(f"// UV Coordinates\n")
+                out.write(f"SVECTOR {prefix}_uvs[{prefix_upper}_UVS_COUNT] = {{\n")
+                out.rows("    { %d, %d, 0 },\n", uvs)
+                out.write("};\n\n")
+            
+            out.write("// Faces\n")
+            
+            if tri_count > 0:
+                out.write(f"int {prefix}_tri_faces[{tri_count}][3] = {{\n")
+                out.rows("    { %d, %d, %d },\n", [f['vertices'] for f in tri_faces])
+                out.write("};\n\n")
+                
+                if len(uvs):
+                    out.write(f"int {prefix}_tri_uvs[{tri_count}][3] = {{\n")
+                    out.rows("    { %d, %d, %d },\n", [f['uvs'] for f in tri_faces])
+                    out.write("};\n\n")
+            else:
+                # Export dummy arrays for models with no triangles
+                out.write(f"int {prefix}_tri_faces[1][3] = {{ {{0, 0, 0}} }};\n")
+                if len(uvs):
+                    out.write(f"int {prefix}_tri_uvs[1][3] = {{ {{0, 0, 0}} }};\n")
+                out.write("\n")
+            
+            if quad_count > 0:
+                out.write(f"int {prefix}_quad_faces[{quad_count}][4] = {{\n")
+                out.rows("    { %d, %d, %d, %d },\n", [f['vertices'] for f in quad_faces])
+                out.write("};\n\n")
+                
+                if len(uvs):
+                    out.write(f"int {prefix}_quad_uvs[{quad_count}][4] = {{\n")
+                    out.rows("    { %d, %d, %d, %d },\n", [f['uvs'] for f in quad_faces])
+                    out.write("};\n\n")
+            else:
+                # Export dummy arrays for models with no quads
+                out.write(f"int {prefix}_quad_faces[1][4] = {{ {{0, 0, 0, 0}} }};\n")
+                if len(uvs):
+                    out.write(f"int {prefix}_quad_uvs[1][4] = {{ {{0, 0, 0, 0}} }};\n")
+                out.write("\n")
+            
+            # Material flags: Bit 0: unlit, Bit 1: textured, Bit 2: smooth, Bit 3: vertex_color, Bit 4: alpha, Bit 5: cutout, Bit 6: specular, Bit 7: metallic
+            out.write(f"unsigned char {prefix}_material_flags[{prefix_upper}_FACES_COUNT] = {{\n")
+            
+            # Write material flags in same order as faces: triangles first, then quads
+            ordered_materials = [mat for mat, face in zip(materials, faces) if face['is_tri']]
+            ordered_materials += [mat for mat, face in zip(materials, faces) if not face['is_tri']]
+            
+            ordered_flags = []
+            for mat in ordered_materials:
+                flags = 0
+                if not mat['is_lit']:
+                    flags |= (1 << 0)
+                if mat['is_textured']:
+                    flags |= (1 << 1)
+                if mat['is_smooth']:
+                    flags |= (1 << 2)
+                if mat['has_vertex_colors']:
+                    flags |= (1 << 3)
+                if mat['has_alpha'] and enable_semi_transparency:
+                    flags |= (1 << 4)
+                if mat['has_alpha'] and enable_cutout_transparency:
+                    flags |= (1 << 5)
+                if self.enable_specular:
+                    flags |= (1 << 6)
+                if self.enable_metallic:
+                    flags |= (1 << 7)
+                ordered_flags.append(flags)
+                desc = []
+                desc.append("unlit" if not mat['is_lit'] else "lit")
+                if mat['is_textured']:
+                    desc.append("textured")
+                desc.append("smooth" if mat['is_smooth'] else "flat")
+                if mat['has_vertex_colors']:
+                    desc.append("vertex-colored")
+                if mat['has_alpha']:
+                    if enable_semi_transparency:
+                        desc.append("alpha")
+                    if enable_cutout_transparency:
+                        desc.append("cutout")
+                if self.enable_specular:
+                    desc.append(f"specular({mat.get('specular', 0.5):.2f})")
+                if self.enable_metallic:
+                    desc.append(f"metallic({mat.get('metallic', 0.0):.2f})")
+                out.write(f"    0b{flags:08b},  // " + ", ".join(desc) + "\n")
+            
+            out.write("};\n\n")
+            
+            # Export specular values if enabled
             if self.enable_specular:
-                desc.append(f"specular({mat.get('specular', 0.5):.2f})")
+                out.write(f"// Specular values (0-255, where 255 = maximum specular)\n")
+                out.write(f"unsigned char {prefix}_specular[{prefix_upper}_FACES_COUNT] = {{\n")
+                for mat in ordered_materials:
+                    specular_value = int(mat.get('specular', 0.5) * 255)
+                    out.write(f"    {specular_value},  // {mat.get('specular', 0.5):.2f}\n")
+                out.write("};\n\n")
+            
+            # Export metallic values if enabled
             if self.enable_metallic:
-                desc.append(f"metallic({mat.get('metallic', 0.0):.2f})")
-            content += ", ".join(desc) + "\n"
+                out.write(f"// Metallic values (0-255, where 255 = fully metallic)\n")
+                out.write(f"unsigned char {prefix}_metallic[{prefix_upper}_FACES_COUNT] = {{\n")
+                for mat in ordered_materials:
+                    metallic_value = int(mat.get('metallic', 0.0) * 255)
+                    out.write(f"    {metallic_value},  // {mat.get('metallic', 0.0):.2f}\n")
+                out.write("};\n\n")
+            
+            # Export mesh IDs for per-mesh visibility control (triangles first, then quads)
+            out.write(f"// Mesh IDs (for per-mesh visibility)\n")
+            out.write(f"unsigned char {prefix}_mesh_ids[{prefix_upper}_FACES_COUNT] = {{\n")
+            for face in tri_faces + quad_faces:
+                out.write(f"    {face.get('mesh_id', 0)},  // {face.get('mesh_name', 'unknown')}\n")
+            out.write("};\n\n")
+            
+            if grid:
+                self.write_grid(out, prefix, prefix_upper, faces, grid)
+            
+            # Per-mesh [start, count] ranges so hidden meshes skip whole runs of faces
+            # (only valid while faces are ordered by mesh, i.e. without a grid)
+            tri_mesh_counts = [0] * len(mesh_names)
+            quad_mesh_counts = [0] * len(mesh_names)
+            for face in faces:
+                if face['is_tri']:
+                    tri_mesh_counts[face['mesh_id']] += 1
+                else:
+                    quad_mesh_counts[face['mesh_id']] += 1
+            
+            out.write("// Sub-mesh face ranges { start, count } (faces are ordered by mesh)\n")
+            out.write(f"#define {prefix_upper}_MESH_COUNT {len(mesh_names)}\n")
+            for mesh_id, mesh_name in enumerate(mesh_names):
+                clean_name = mesh_name.upper().replace(' ', '_').replace('-', '_').replace('.', '_')
+                out.write(f"#define {prefix_upper}_MESH_{clean_name} {mesh_id}\n")
+            out.write("\n")
+            
+            if not grid:
+                for kind, mesh_counts in (('tri', tri_mesh_counts), ('quad', quad_mesh_counts)):
+                    out.write(f"unsigned short {prefix}_{kind}_ranges[{prefix_upper}_MESH_COUNT][2] = {{\n")
+                    start = 0
+                    for mesh_name, count in zip(mesh_names, mesh_counts):
+                        out.write(f"    {{ {start}, {count} }},  // {mesh_name}\n")
+                        start += count
+                    out.write("};\n\n")
+            
+            # Pre-initialised GPU primitives, one packet per face in tri-then-quad order
+            if self.export_prim_templates and self.header_type == 'PSYQ':
+                uv_rows = uvs.tolist()
+                color_rows = vertex_colors.tolist()
+                templates = [build_prim_template(face, flags, uv_rows, color_rows)
+                             for face, flags in zip(tri_faces + quad_faces, ordered_flags)]
+                total_words = sum(len(words) for words in templates)
+                out.write("// Primitive templates (GPU packets per face; XY, tpage and clut filled at runtime)\n")
+                out.write(f"#define {prefix_upper}_PRIM_TEMPLATE_WORDS {total_words}\n")
+                out.write(f"#define {prefix_upper}_PRIM_BUFFER_SIZE ({prefix_upper}_PRIM_TEMPLATE_WORDS * 4)\n")
+                out.write(f"u_long {prefix}_prim_templates[{prefix_upper}_PRIM_TEMPLATE_WORDS] = {{\n")
+                for words in templates:
+                    out.write("    " + ", ".join(f"0x{w:08X}" for w in words) + ",\n")
+                out.write("};\n\n")
+            
+            # Always export vertex_colors array (even if empty) so code compiles
+            out.write(f"// Vertex Colors\n")
+            if has_vertex_colors and len(vertex_colors):
+                out.write(f"#define {prefix_upper}_VERTEX_COLORS_COUNT {len(vertex_colors)}\n")
+                out.write(f"CVECTOR {prefix}_vertex_colors[{prefix_upper}_VERTEX_COLORS_COUNT] = {{\n")
+                out.rows("    { %d, %d, %d, 0 },\n", vertex_colors)
+                out.write("};\n\n")
+            else:
+                # Export empty array for models without vertex colors
+                out.write(f"#define {prefix_upper}_VERTEX_COLORS_COUNT 1\n")
+                out.write(f"CVECTOR {prefix}_vertex_colors[{prefix_upper}_VERTEX_COLORS_COUNT] = {{\n")
+                out.write("    { 128, 128, 128, 0 }  // Default gray\n")
+                out.write("};\n\n")
+            
+            out.write("#endif\n")
         
-        content += "};\n\n"
-                # Export specular values if enabled
-        if self.enable_specular:
-            content += f"// Specular values (0-255, where 255 = maximum specular)\n"
-            content += f"unsigned char {prefix}_specular[{prefix_upper}_FACES_COUNT] = {{\n"
-            for mat in ordered_materials:
-                specular_value = int(mat.get('specular', 0.5) * 255)
-                content += f"    {specular_value},  // {mat.get('specular', 0.5):.2f}\n"
-            content += "};\n\n"
+        # Report figures: arrays as declared above, and the primitive each face
+        # draws with (the same packet layouts as the templates)
+        stats = new_header_stats(
+            geometry={'vertices': len(vertices), 'uvs': len(uvs), 'faces': len(faces), 'tris': tri_count,
+                      'quads': quad_count, 'meshes': len(mesh_names),
+                      'vertex_colors': len(vertex_colors) if has_vertex_colors else 0},
+            primitives={}, packet_bytes=0,
+            textures={mat['texture_name']: [mat['texture_width'], mat['texture_height']]
+                      for mat in materials if mat['texture_name']})
+        for face, flags in zip(tri_faces + quad_faces, ordered_flags):
+            is_textured = bool(flags & (1 << 1))
+            is_smooth = bool(flags & (1 << 2))
+            prim = f"POLY_{'G' if is_smooth else 'F'}{'T' if is_textured else ''}{3 if face['is_tri'] else 4}"
+            stats['primitives'][prim] = stats['primitives'].get(prim, 0) + 1
+            stats['packet_bytes'] += len(PRIM_TEMPLATE_LAYOUTS[(is_textured, is_smooth, not face['is_tri'])][1]) * 4
         
-        # Export metallic values if enabled
+        add_array(stats, f"{prefix}_vertices", 'SVECTOR', len(vertices))
+        add_array(stats, f"{prefix}_normals", 'SVECTOR', len(vertices))
+        for kind, count, size in (('tri', tri_count, 3), ('quad', quad_count, 4)):
+            add_array(stats, f"{prefix}_{kind}_faces", 'int', max(1, count) * size)
+            if len(uvs):
+                add_array(stats, f"{prefix}_{kind}_uvs", 'int', max(1, count) * size)
+            if not grid:
+                add_array(stats, f"{prefix}_{kind}_ranges", 'unsigned short', len(mesh_names) * 2)
+            else:
+                add_array(stats, f"{prefix}_cell_{kind}_ranges", 'unsigned short', grid['width'] * grid['depth'] * 2)
+        if len(uvs):
+            add_array(stats, f"{prefix}_uvs", 'SVECTOR', len(uvs))
+        add_array(stats, f"{prefix}_material_flags", 'unsigned char', len(faces))
+        if self.enable_specular:
+            add_array(stats, f"{prefix}_specular", 'unsigned char', len(faces))
         if self.enable_metallic:
-            content += f"// Metallic values (0-255, where 255 = fully metallic)\n"
-            content += f"unsigned char {prefix}_metallic[{prefix_upper}_FACES_COUNT] = {{\n"
-            for mat in ordered_materials:
-                metallic_value = int(mat.get('metallic', 0.0) * 255)
-                content += f"    {metallic_value},  // {mat.get('metallic', 0.0):.2f}\n"
-            content += "};\n\n"
-        
-        # Export mesh IDs for per-mesh visibility control
-        content += f"// Mesh IDs (for per-mesh visibility)\n"
-        content += f"unsigned char {prefix}_mesh_ids[{prefix_upper}_FACES_COUNT] = {{\n"
-        # Write triangle mesh IDs first
-        for face in faces:
-            if face['is_tri']:
-                mesh_id = face.get('mesh_id', 0)
-                mesh_name = face.get('mesh_name', 'unknown')
-                content += f"    {mesh_id},  // {mesh_name}\n"
-        # Then write quad mesh IDs
-        for face in faces:
-            if not face['is_tri']:
-                mesh_id = face.get('mesh_id', 0)
-                mesh_name = face.get('mesh_name', 'unknown')
-                content += f"    {mesh_id},  // {mesh_name}\n"
-        content += "};\n\n"
+            add_array(stats, f"{prefix}_metallic", 'unsigned char', len(faces))
+        add_array(stats, f"{prefix}_mesh_ids", 'unsigned char', len(faces))
+        if grid:
+            add_array(stats, f"{prefix}_cell_bounds", 'long', grid['width'] * grid['depth'] * 4)
+        if self.export_prim_templates and self.header_type == 'PSYQ':
+            add_array(stats, f"{prefix}_prim_templates", 'u_long', total_words)
+        add_array(stats, f"{prefix}_vertex_colors", 'CVECTOR', len(vertex_colors) if has_vertex_colors and len(vertex_colors) else 1)
+        return stats
+    
+    def write_grid(self, out, prefix, prefix_upper, faces, grid):
+        """Spatial grid defines, per-cell face ranges and cell bounds"""
+        long_type = "int32_t" if self.header_type == 'PSYQO' else "long"
+        cell_count = grid['width'] * grid['depth']
         
-        # Always export vertex_colors array (even if empty) so code compiles
-        content += f"// Vertex Colors\n"
-        if has_vertex_colors and vertex_colors:
-            content += f"#define {prefix_upper}_VERTEX_COLORS_COUNT {len(vertex_colors)}\n"
-            content += f"CVECTOR {prefix}_vertex_colors[{prefix_upper}_VERTEX_COLORS_COUNT] = {{\n"
-            for vc in vertex_colors:
-                content += f"    {{ {vc['r']}, {vc['g']}, {vc['b']}, 0 }},\n"
-            content += "};\n\n"
-        else:
-            # Export empty array for models without vertex colors
-            content += f"#define {prefix_upper}_VERTEX_COLORS_COUNT 1\n"
-            content += f"CVECTOR {prefix}_vertex_colors[{prefix_upper}_VERTEX_COLORS_COUNT] = {{\n"
-            content += "    { 128, 128, 128, 0 }  // Default gray\n"
-            content += "};\n\n"
+        out.write("// Spatial grid over X/Z (faces are ordered by cell, cell = z * width + x)\n")
+        out.write(f"#define {prefix_upper}_GRID_CELL_SIZE {grid['cell_size']}\n")
+        out.write(f"#define {prefix_upper}_GRID_WIDTH {grid['width']}\n")
+        out.write(f"#define {prefix_upper}_GRID_DEPTH {grid['depth']}\n")
+        out.write(f"#define {prefix_upper}_GRID_CELL_COUNT {cell_count}\n")
+        out.write(f"#define {prefix_upper}_GRID_ORIGIN_X {grid['origin_x']}\n")
+        out.write(f"#define {prefix_upper}_GRID_ORIGIN_Z {grid['origin_z']}\n")
+        out.write(f"#define {prefix_upper}_GRID_MIN_Y {grid['min_y']}\n")
+        out.write(f"#define {prefix_upper}_GRID_MAX_Y {grid['max_y']}\n")
+        out.write(f"#define {prefix_upper}_GRID_MARGIN {grid['margin']}\n\n")
         
-        content += "#endif\n"
+        for kind, is_tri in (('tri', True), ('quad', False)):
+            counts = [0] * cell_count
+            for face in faces:
+                if face['is_tri'] == is_tri:
+                    counts[face['cell']] += 1
+            out.write(f"unsigned short {prefix}_cell_{kind}_ranges[{prefix_upper}_GRID_CELL_COUNT][2] = {{\n")
+            starts = itertools.accumulate([0] + counts[:-1])
+            out.rows("    { %d, %d },\n", list(zip(starts, counts)))
+            out.write("};\n\n")
         
-        with open(filepath, 'w', encoding='utf-8') as f:
-            f.write(content)
+        out.write(f"// Cell bounding spheres {{ cx, cy, cz, radius }}\n")
+        out.write(f"{long_type} {prefix}_cell_bounds[{prefix_upper}_GRID_CELL_COUNT][4] = {{\n")
+        out.rows("    { %d, %d, %d, %d },\n", grid['bounds'])
+        out.write("};\n\n")
     
-    def export_all_animations(self, mesh_objects, export_dir, base_name):
-        """Export animations"""
-        if not bpy.data.actions:
-            return
-        
-        original_frame = bpy.context.scene.frame_current
-        
-        # Find armature objects that control the mesh
+    def get_export_actions(self, mesh_objects):
+        """Armatures deforming the meshes, and the actions to bake: those for this
+        rig (when Only Rig Actions is set) that pass the name filters"""
         armature_objects = []
         for obj in mesh_objects:
             for modifier in obj.modifiers:
@@ -734,32 +1553,78 @@ SVECTOR {prefix}_vertices[{prefix_upper}_VERTICES_COUNT] = {{
                     if modifier.object not in armature_objects:
                         armature_objects.append(modifier.object)
         
-        # Store original actions for all animated objects
-        original_actions = {}
-        for obj in mesh_objects:
-            if obj.animation_data:
-                original_actions[obj.name] = obj.animation_data.action
-        for armature in armature_objects:
-            if armature.animation_data:
-                original_actions[armature.name] = armature.animation_data.action
+        actions = [action for action in bpy.data.actions
+                   if matches_action_patterns(action.name, self.action_include, self.action_exclude)
+                   and (not self.rig_actions_only or is_rig_action(action, mesh_objects, armature_objects))]
+        return armature_objects, actions
+    
+    def bake_actions(self, mesh_objects, armature_objects, actions):
+        """Bake every action up front; returns {action name: (first frame, frames)} for those that bake"""
+        baked = {}
+        with AnimationState(mesh_objects, armature_objects):
+            for action in actions:
+                result = self.bake_action(mesh_objects, armature_objects, action)
+                if result is not None:
+                    baked[action.name] = result
+        return baked
+    
+    def export_all_animations(self, mesh_objects, export_dir, base_name, cache=None, mesh_hash="", baked=None):
+        """Export animations (actions whose cached inputs are unchanged are not re-baked)
+        baked holds frames already baked by bake_actions; without it each action is baked here.
+        Returns the stats of every animation header, keyed by file name"""
+        header_stats = {}
+        if not bpy.data.actions:
+            return header_stats
         
-        for action in bpy.data.actions:
-            action_name = action.name.replace(' ', '_').replace('-', '_')
-            anim_filepath = os.path.join(export_dir, f"{base_name}-{action_name}.h")
-            self.export_animation(mesh_objects, armature_objects, action, anim_filepath, base_name, action_name)
+        # Skip actions for other rigs and anything filtered out by name
+        armature_objects, actions = self.get_export_actions(mesh_objects)
+        skipped = len(bpy.data.actions) - len(actions)
+        if skipped:
+            self.add_note(f"{skipped} action(s) not baked (other rigs or filtered by name)")
         
-        bpy.context.scene.frame_set(original_frame)
-        for obj in mesh_objects:
-            if obj.name in original_actions and obj.animation_data:
-                obj.animation_data.action = original_actions[obj.name]
-        for armature in armature_objects:
-            if armature.name in original_actions and armature.animation_data:
-                armature.animation_data.action = original_actions[armature.name]
-    
-    def export_animation(self, mesh_objects, armature_objects, action, filepath, base_name, action_name):
-        """Export animation"""
-        guard_name = f"{base_name}_{action_name}".upper().replace('-', '_').replace(' ', '_')
+        rig_hash = ""
+        if cache is not None:
+            hasher = hashlib.sha1()
+            hash_rig(hasher, mesh_objects, armature_objects)
+            rig_hash = hasher.hexdigest()
         
+        exported_actions = []
+        with AnimationState(mesh_objects, armature_objects):
+            for action in actions:
+                action_name = action.name.replace(' ', '_').replace('-', '_')
+                anim_filepath = os.path.join(export_dir, f"{base_name}-{action_name}.h")
+                
+                if cache is not None:
+                    hasher = hashlib.sha1()
+                    hash_action(hasher, action)
+                    action_key = cache.key("action", mesh_hash, rig_hash, hasher.hexdigest())
+                    if cache.is_fresh(anim_filepath, action_key):
+                        exported_actions.append(action_name)
+                        header_stats[os.path.basename(anim_filepath)] = cache.get_stats(anim_filepath)
+                        continue
+                
+                if baked is not None:
+                    result = baked.get(action.name)
+                else:
+                    result = self.bake_action(mesh_objects, armature_objects, action)
+                if result is None:
+                    continue
+                
+                stats = self.write_animation(anim_filepath, base_name, action_name, *result)
+                exported_actions.append(action_name)
+                header_stats[os.path.basename(anim_filepath)] = stats
+                if cache is not None:
+                    cache.store(anim_filepath, action_key, stats)
+        
+        # Action table so the runtime can drive any exported action by index
+        if exported_actions:
+            actions_filepath = os.path.join(export_dir, f"{base_name}-actions.h")
+            header_stats[os.path.basename(actions_filepath)] = self.write_action_table(actions_filepath, base_name, exported_actions)
+        return header_stats
+    
+    def bake_action(self, mesh_objects, armature_objects, action):
+        """Bake one action to fixed-point world positions of every model vertex
+        Returns (first frame, int array [frame][vertex][xyz]), or None if the action could not be baked"""
         # Set the action on armature objects (where animations actually live)
         for armature in armature_objects:
             if armature.animation_data is None:
@@ -771,45 +1636,49 @@ SVECTOR {prefix}_vertices[{prefix_upper}_VERTICES_COUNT] = {{
             if obj.animation_data:
                 obj.animation_data.action = action
         
-        # Force depsgraph update to ensure action is applied
-        bpy.context.view_layer.update()
-        
         frame_start = int(action.frame_range[0])
         frame_end = int(action.frame_range[1])
         frame_count = frame_end - frame_start + 1
         
-        animation_data = []
+        # Frames must line up with the model's vertex arrays
+        counts = [len(self.get_export_mesh(obj).vertices) for obj in mesh_objects]
         
-        for frame in range(frame_start, frame_end + 1):
+        # Evaluated coordinates for every frame, read in place by foreach_get
+        frames = np.empty((frame_count, sum(counts), 3), dtype=np.float32)
+        
+        for frame_idx, frame in enumerate(range(frame_start, frame_end + 1)):
+            # frame_set evaluates the depsgraph once; every object reads from it
             bpy.context.scene.frame_set(frame)
-            # Force update after frame change
-            bpy.context.view_layer.update()
-            
-            frame_vertices = []
+            depsgraph = bpy.context.evaluated_depsgraph_get()
             
-            for obj in mesh_objects:
-                # Get fresh depsgraph for this frame
-                depsgraph = bpy.context.evaluated_depsgraph_get()
-                depsgraph.update()
+            offset = 0
+            for obj, count in zip(mesh_objects, counts):
                 eval_obj = obj.evaluated_get(depsgraph)
                 mesh = eval_obj.to_mesh()
+                if len(mesh.vertices) != count:
+                    eval_obj.to_mesh_clear()
+                    self.add_note(f"{obj.name} changes vertex count in {action.name} (frame {frame}), action skipped")
+                    return None
                 
-                # Get the world matrix to apply object transforms
-                world_matrix = eval_obj.matrix_world
+                block = frames[frame_idx, offset:offset + count]
+                mesh.vertices.foreach_get("co", block.reshape(-1))
                 
-                for vert in mesh.vertices:
-                    # Apply object's world transform (includes scale, rotation, location)
-                    world_coord = world_matrix @ vert.co
-                    coord = convert_coordinate(world_coord, self.convert_coords)
-                    frame_vertices.append({
-                        'x': int(coord[0] * PS1_SCALE_FACTOR),
-                        'y': int(coord[1] * PS1_SCALE_FACTOR),
-                        'z': int(coord[2] * PS1_SCALE_FACTOR)
-                    })
+                # Object transform at this frame (includes scale, rotation, location)
+                block[:] = transform_points(eval_obj.matrix_world, block)
                 
                 eval_obj.to_mesh_clear()
-            
-            animation_data.append(frame_vertices)
+                offset += count
+        
+        # PS1 axes and fixed point for the whole block at once (truncated like int())
+        coords = convert_coordinates(frames.reshape(-1, 3).astype(np.float64), self.convert_coords)
+        animation_data = np.trunc(coords * PS1_SCALE_FACTOR).astype(np.int64).reshape(frame_count, -1, 3)
+        check_svector_range(animation_data, f"Vertices in action {action.name}")
+        return frame_start, animation_data
+    
+    def write_animation(self, filepath, base_name, action_name, frame_start, animation_data):
+        """Write one baked action's header; returns the header's stats"""
+        guard_name = f"{base_name}_{action_name}".upper().replace('-', '_').replace(' ', '_')
+        frame_count = len(animation_data)
         
         # Choose includes and type definitions based on header type
         if self.header_type == 'PSYQO':
@@ -825,7 +1694,8 @@ typedef struct {
             includes = """#include <sys/types.h>
 #include <libgte.h>"""
         
-        content = f"""// PlayStation 1 Animation Export
+        with self.open_header(filepath) as out:
+            out.write(f"""// PlayStation 1 Animation Export
 // Model: {base_name}
 // Animation: {action_name}
 // Frames: {frame_count}
@@ -836,21 +1706,684 @@ typedef struct {
 {includes}
 
 #define {action_name.upper()}_FRAMES_COUNT {frame_count}
-#define {action_name.upper()}_VERTICES_COUNT {len(animation_data[0]) if animation_data else 0}
+#define {action_name.upper()}_VERTICES_COUNT {animation_data.shape[1]}
 
 SVECTOR {action_name}_anim[{action_name.upper()}_FRAMES_COUNT][{action_name.upper()}_VERTICES_COUNT] = {{
+""")
+            
+            for frame_idx, frame_verts in enumerate(animation_data):
+                out.write(f"    {{ // Frame {frame_start + frame_idx}\n")
+                out.rows("        { %d, %d, %d },\n", frame_verts)
+                out.write("    },\n")
+            
+            out.write("};\n\n#endif\n")
+        
+        stats = new_header_stats(action=action_name, frames=frame_count, vertices=animation_data.shape[1])
+        add_array(stats, f"{action_name}_anim", 'SVECTOR', frame_count * animation_data.shape[1])
+        return stats
+
+    def write_action_table(self, filepath, base_name, action_names):
+        """Write the action table header listing every exported action"""
+        guard_name = f"{base_name}_actions".upper().replace('-', '_').replace(' ', '_')
+        prefix = base_name.lower().replace('-', '_').replace(' ', '_')
+        prefix_upper = prefix.upper()
+        
+        # Actions are baked one Blender frame per animation frame
+        render = bpy.context.scene.render
+        fps = max(1, int(round(render.fps / render.fps_base)))
+        
+        # Choose includes and type definitions based on header type
+        if self.header_type == 'PSYQO':
+            includes = """#include <stdint.h>
+
+#ifndef SVECTOR_DEFINED
+#define SVECTOR_DEFINED
+typedef struct {
+    int16_t vx, vy, vz;
+} SVECTOR;
+#endif"""
+        else:  # PSYQ
+            includes = """#include <sys/types.h>
+#include <libgte.h>"""
+        
+        content = f"""// PlayStation 1 Animation Table
+// Model: {base_name}
+// Actions: {len(action_names)}
+
+#ifndef {guard_name}_H
+#define {guard_name}_H
+
+{includes}
+
+"""
+        for action_name in action_names:
+            content += f"#include \"{base_name}-{action_name}.h\"\n"
+        
+        content += """
+#ifndef ANIMACTION_DEFINED
+#define ANIMACTION_DEFINED
+typedef struct {
+    const char *name;     // Action name
+    int frame_count;      // Number of baked frames
+    int vertex_count;     // Vertices per frame
+    SVECTOR *frames;      // frame_count * vertex_count vertices
+    int fps;              // Playback rate the action was baked at
+} AnimAction;
+#endif
+
+"""
+        content += f"#define {prefix_upper}_ACTIONS_COUNT {len(action_names)}\n"
+        for i, action_name in enumerate(action_names):
+            content += f"#define {prefix_upper}_ACTION_{action_name.upper()} {i}\n"
+        content += "\n"
+        
+        content += f"AnimAction {prefix}_actions[{prefix_upper}_ACTIONS_COUNT] = {{\n"
+        for action_name in action_names:
+            name_upper = action_name.upper()
+            content += f"    {{ \"{action_name}\", {name_upper}_FRAMES_COUNT, {name_upper}_VERTICES_COUNT, &{action_name}_anim[0][0], {fps} }},\n"
+        content += "};\n\n#endif\n"
+        
+        with self.open_header(filepath) as out:
+            out.write(content)
+        
+        stats = new_header_stats()
+        add_array(stats, f"{prefix}_actions", 'AnimAction', len(action_names))
+        return stats
+
+    def write_portals(self, filepath, base_name, mesh_objects):
+        """Write room bounds, portals and the per-room PVS (rooms are the model's sub-meshes)"""
+        guard_name = f"{base_name}_portals".upper().replace('-', '_').replace(' ', '_')
+        prefix = base_name.lower().replace('-', '_').replace(' ', '_')
+        prefix_upper = prefix.upper()
+        
+        if len(mesh_objects) > PORTAL_MAX_ROOMS:
+            raise ExportError(f"Portals support at most {PORTAL_MAX_ROOMS} rooms (32-bit room masks), "
+                              f"but the model has {len(mesh_objects)} meshes; merge some rooms")
+        
+        room_bounds = [get_room_bounds(obj) for obj in mesh_objects]
+        
+        # Each portal joins the rooms found just in front of and behind its plane
+        portals = []
+        portal_names = []
+        for obj in sorted([o for o in bpy.data.objects if is_portal(o)], key=lambda o: o.name):
+            if not obj.data.polygons:
+                self.add_note(f"Portal {obj.name} has no face, skipped")
+                continue
+            shape = get_portal_shape(obj)
+            _, center, normal = shape
+            room_a = find_room(center + normal * PORTAL_PROBE_DISTANCE, room_bounds)
+            room_b = find_room(center - normal * PORTAL_PROBE_DISTANCE, room_bounds)
+            if room_a < 0 or room_b < 0 or room_a == room_b:
+                self.add_note(f"Portal {obj.name} does not join two rooms, skipped")
+                continue
+            portals.append((room_a, room_b, shape))
+            portal_names.append(obj.name)
+        
+        pvs = build_pvs(len(mesh_objects), portals)
+        
+        if self.header_type == 'PSYQO':
+            includes = """#include <stdint.h>
+
+#ifndef SVECTOR_DEFINED
+#define SVECTOR_DEFINED
+typedef struct {
+    int16_t vx, vy, vz;
+} SVECTOR;
+#endif"""
+            long_type = "int32_t"
+            ulong_type = "uint32_t"
+        else:  # PSYQ
+            includes = """#include <sys/types.h>
+#include <libgte.h>"""
+            long_type = "long"
+            ulong_type = "u_long"
+        
+        content = f"""// PlayStation 1 Portals and PVS
+// Model: {base_name}
+// Rooms: {len(mesh_objects)} (the model's sub-meshes)
+// Portals: {len(portals)}
+
+#ifndef {guard_name}_H
+#define {guard_name}_H
+
+{includes}
+
+#ifndef PORTAL_DEFINED
+#define PORTAL_DEFINED
+typedef struct {{
+    short room_a;               // Room in front of the portal plane
+    short room_b;               // Room behind it
+    SVECTOR verts[4];           // Portal corners (model space)
+}} Portal;
+#endif
+
+#define {prefix_upper}_ROOM_COUNT {len(mesh_objects)}
+#define {prefix_upper}_PORTAL_COUNT {len(portals)}
+
+"""
+        # Room AABBs in PS1 space (Z-up conversion can swap min and max)
+        content += f"// Room bounds {{ min_x, min_y, min_z, max_x, max_y, max_z }}\n"
+        content += f"{long_type} {prefix}_room_bounds[{prefix_upper}_ROOM_COUNT][6] = {{\n"
+        for obj, (lo, hi) in zip(mesh_objects, room_bounds):
+            a = [int(c * PS1_SCALE_FACTOR) for c in convert_coordinate(lo, self.convert_coords)]
+            b = [int(c * PS1_SCALE_FACTOR) for c in convert_coordinate(hi, self.convert_coords)]
+            box = [min(a[i], b[i]) for i in range(3)] + [max(a[i], b[i]) for i in range(3)]
+            content += f"    {{ {', '.join(str(v) for v in box)} }},  // {obj.name}\n"
+        content += "};\n\n"
+        
+        content += f"Portal {prefix}_portals[{max(1, len(portals))}] = {{\n"
+        for (room_a, room_b, shape), name in zip(portals, portal_names):
+            corners = list(shape[0]) + [shape[0][-1]] * (4 - len(shape[0]))
+            fixed = [[int(c * PS1_SCALE_FACTOR) for c in convert_coordinate(corner, self.convert_coords)] for corner in corners]
+            check_svector_range(fixed, f"Corners of portal {name}")
+            verts = [f"{{ {v[0]}, {v[1]}, {v[2]} }}" for v in fixed]
+            content += f"    {{ {room_a}, {room_b}, {{ {', '.join(verts)} }} }},  // {name}\n"
+        if not portals:
+            content += "    { -1, -1, { { 0, 0, 0 } } }  // No portals\n"
+        content += "};\n\n"
+        
+        content += f"// Potentially visible rooms per room (bit = room index)\n"
+        content += f"{ulong_type} {prefix}_pvs[{prefix_upper}_ROOM_COUNT] = {{\n"
+        for obj, visible in zip(mesh_objects, pvs):
+            mask = sum(1 << r for r in visible)
+            content += f"    0x{mask:08X},  // {obj.name}\n"
+        content += "};\n\n#endif\n"
+        
+        with self.open_header(filepath) as out:
+            out.write(content)
+        
+        stats = new_header_stats()
+        add_array(stats, f"{prefix}_room_bounds", long_type, len(mesh_objects) * 6)
+        add_array(stats, f"{prefix}_portals", 'Portal', max(1, len(portals)))
+        add_array(stats, f"{prefix}_pvs", ulong_type, len(mesh_objects))
+        return stats
+    
+    def write_collision(self, filepath, base_name, mesh_objects):
+        """Write the collision triangle soup with per-triangle normals"""
+        guard_name = f"{base_name}_collision".upper().replace('-', '_').replace(' ', '_')
+        prefix = base_name.lower().replace('-', '_').replace(' ', '_')
+        prefix_upper = prefix.upper()
+        
+        # Collision objects and collision-material faces; when the file has
+        # neither, the render meshes collide as they are
+        sources = []
+        for obj in sorted([o for o in bpy.data.objects if is_collision_object(o)], key=lambda o: o.name):
+            sources.extend((obj, obj.data, poly) for poly in obj.data.polygons)
+        for obj in mesh_objects:
+            mesh = self.get_export_mesh(obj)
+            sources.extend((obj, mesh, poly) for poly in mesh.polygons if is_collision_material(mesh, poly))
+        if not sources:
+            for obj in mesh_objects:
+                mesh = self.get_export_mesh(obj)
+                sources.extend((obj, mesh, poly) for poly in mesh.polygons)
+        
+        vertices = []
+        vertex_index = {}  # Quantised position -> index, welds shared corners
+        tris = []
+        normals = []
+        for obj, mesh, poly in sources:
+            world_matrix = obj.matrix_world
+            normal_matrix = world_matrix.to_3x3().inverted_safe().transposed()
+            normal = convert_coordinate((normal_matrix @ poly.normal).normalized(), self.convert_coords)
+            
+            indices = []
+            for vert_idx in poly.vertices:
+                coord = convert_coordinate(world_matrix @ mesh.vertices[vert_idx].co, self.convert_coords)
+                key = tuple(int(c * PS1_SCALE_FACTOR) for c in coord)
+                if key not in vertex_index:
+                    vertex_index[key] = len(vertices)
+                    vertices.append(key)
+                indices.append(vertex_index[key])
+            
+            # Fan-split quads and n-gons, dropping slivers collapsed by quantisation
+            for i in range(1, len(indices) - 1):
+                tri = (indices[0], indices[i], indices[i + 1])
+                if len(set(tri)) < 3:
+                    continue
+                tris.append(tri)
+                normals.append(tuple(int(c * 4096) for c in normal))
+        
+        check_svector_range(vertices, "Collision vertices")
+        if len(vertices) > COLLISION_MAX_VERTICES:
+            raise ExportError(f"Collision mesh has {len(vertices)} vertices, more than the "
+                              f"{COLLISION_MAX_VERTICES} its 16-bit triangle indices can address")
+        cell_shift = get_collision_cell_shift(vertices, tris)
+        
+        if self.header_type == 'PSYQO':
+            includes = """#include <stdint.h>
+
+#ifndef SVECTOR_DEFINED
+#define SVECTOR_DEFINED
+typedef struct {
+    int16_t vx, vy, vz;
+} SVECTOR;
+#endif"""
+            index_type = "uint16_t"
+        else:  # PSYQ
+            includes = """#include <sys/types.h>
+#include <libgte.h>"""
+            index_type = "unsigned short"
+        
+        with self.open_header(filepath) as out:
+            out.write(f"""// PlayStation 1 Collision Mesh
+// Model: {base_name}
+// Triangles: {len(tris)}
+
+#ifndef {guard_name}_H
+#define {guard_name}_H
+
+{includes}
+
+#define {prefix_upper}_COLLISION_VERTICES_COUNT {len(vertices)}
+#define {prefix_upper}_COLLISION_TRI_COUNT {len(tris)}
+#define {prefix_upper}_COLLISION_CELL_SHIFT {cell_shift}  // Suggested hash cell size (1 << shift)
+
+""")
+            # Arrays keep at least one row so an empty mesh still compiles (C has no zero-length arrays)
+            vertex_size = f"{prefix_upper}_COLLISION_VERTICES_COUNT" if vertices else "1"
+            tri_size = f"{prefix_upper}_COLLISION_TRI_COUNT" if tris else "1"
+            out.write(f"SVECTOR {prefix}_collision_vertices[{vertex_size}] = {{\n")
+            out.rows("    { %d, %d, %d },\n", vertices)
+            if not vertices:
+                out.write("    { 0, 0, 0 }  // No vertices\n")
+            out.write("};\n\n")
+            
+            out.write(f"{index_type} {prefix}_collision_tris[{tri_size}][3] = {{\n")
+            out.rows("    { %d, %d, %d },\n", tris)
+            if not tris:
+                out.write("    { 0, 0, 0 }  // No triangles\n")
+            out.write("};\n\n")
+            
+            out.write(f"// Face normals (ONE = 4096)\n")
+            out.write(f"SVECTOR {prefix}_collision_normals[{tri_size}] = {{\n")
+            out.rows("    { %d, %d, %d },\n", normals)
+            if not tris:
+                out.write("    { 0, 0, 0 }  // No triangles\n")
+            out.write("};\n\n#endif\n")
+        
+        stats = new_header_stats(collision_tris=len(tris))
+        add_array(stats, f"{prefix}_collision_vertices", 'SVECTOR', max(1, len(vertices)))
+        add_array(stats, f"{prefix}_collision_tris", index_type, max(1, len(tris)) * 3)
+        add_array(stats, f"{prefix}_collision_normals", 'SVECTOR', max(1, len(tris)))
+        return stats
+    
+    def write_scene_layout(self, filepath, base_name):
+        """Write the scene table listing every model instance in the .blend"""
+        guard_name = f"{base_name}_scene".upper().replace('-', '_').replace(' ', '_')
+        prefix = base_name.lower().replace('-', '_').replace(' ', '_')
+        prefix_upper = prefix.upper()
+        
+        # Grouped by model so the runtime can draw each run as one instanced batch
+        instances = sorted(
+            [obj for obj in bpy.data.objects if is_scene_instance(obj)],
+            key=lambda obj: (get_scene_instance_model(obj), obj.name)
+        )
+        
+        # Model names in first-use order; instances refer to them by index
+        model_names = []
+        for obj in instances:
+            model = get_scene_instance_model(obj)
+            if model not in model_names:
+                model_names.append(model)
+        
+        if self.header_type == 'PSYQO':
+            includes = "#include <stdint.h>"
+            long_type = "int32_t"
+            ulong_type = "uint32_t"
+            short_type = "int16_t"
+        else:  # PSYQ
+            includes = """#include <sys/types.h>
+#include <libgte.h>"""
+            long_type = "long"
+            ulong_type = "u_long"
+            short_type = "short"
+        
+        fields = ""
+        for decl, comment in (
+            ("int model;", "Index into the scene's model name table"),
+            (f"{long_type} x, y, z;", "Position (scaled by PS1_SCALE)"),
+            (f"{short_type} rx, ry, rz;", "Rotation (4096 = 360 degrees)"),
+            (f"{long_type} sx, sy, sz;", "Scale (4096 = 1.0)"),
+            ("int slot;", "Texture slot"),
+            (f"{ulong_type} visible_meshes;", "Sub-mesh visibility mask"),
+        ):
+            fields += f"    {decl:<24}// {comment}\n"
+        
+        content = f"""// PlayStation 1 Scene Layout
+// Scene: {base_name}
+// Instances: {len(instances)}
+
+#ifndef {guard_name}_H
+#define {guard_name}_H
+
+{includes}
+
+#ifndef SCENEINSTANCE_DEFINED
+#define SCENEINSTANCE_DEFINED
+typedef struct {{
+{fields}}} SceneInstance;
+#endif
+
+#define {prefix_upper}_SCENE_MODEL_COUNT {len(model_names)}
+#define {prefix_upper}_SCENE_INSTANCE_COUNT {len(instances)}
 """
+        for i, model in enumerate(model_names):
+            clean_name = model.upper().replace('.', '_')
+            content += f"#define {prefix_upper}_SCENE_MODEL_{clean_name} {i}\n"
+        content += "\n"
         
-        for frame_idx, frame_verts in enumerate(animation_data):
-            content += f"    {{ // Frame {frame_start + frame_idx}\n"
-            for v in frame_verts:
-                content += f"        {{ {v['x']}, {v['y']}, {v['z']} }},\n"
-            content += "    },\n"
+        if not instances:
+            self.add_note("No scene instances found; the scene header holds one placeholder row and counts of 0")
+        
+        # An empty scene keeps one placeholder row per array (C has no zero-length arrays)
+        model_size = f"{prefix_upper}_SCENE_MODEL_COUNT" if model_names else "1"
+        instance_size = f"{prefix_upper}_SCENE_INSTANCE_COUNT" if instances else "1"
+        content += f"const char *{prefix}_scene_models[{model_size}] = {{\n"
+        for model in model_names:
+            content += f"    \"{model}\",\n"
+        if not model_names:
+            content += "    \"\"  // No instances\n"
+        content += "};\n\n"
         
+        content += f"SceneInstance {prefix}_scene[{instance_size}] = {{\n"
+        for obj in instances:
+            position, rotation, scale = get_scene_instance_transform(obj, self.convert_coords)
+            slot = int(obj.get("ps1_slot", 0))
+            visible = int(obj.get("ps1_visible", 0xFFFFFFFF)) & 0xFFFFFFFF
+            model = model_names.index(get_scene_instance_model(obj))
+            content += (f"    {{ {model}, {position[0]}, {position[1]}, {position[2]}, "
+                        f"{rotation[0]}, {rotation[1]}, {rotation[2]}, "
+                        f"{scale[0]}, {scale[1]}, {scale[2]}, {slot}, 0x{visible:08X} }},  // {obj.name}\n")
+        if not instances:
+            content += "    { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }  // No instances\n"
         content += "};\n\n#endif\n"
         
-        with open(filepath, 'w', encoding='utf-8') as f:
-            f.write(content)
+        with self.open_header(filepath) as out:
+            out.write(content)
+        
+        stats = new_header_stats()
+        add_array(stats, f"{prefix}_scene_models", 'const char *', max(1, len(model_names)))
+        add_array(stats, f"{prefix}_scene", 'SceneInstance', max(1, len(instances)))
+        return stats
+
+class HeadlessExporter(PS1Exporter):
+    """PS1Exporter for background (blender -b) use, without an operator"""
+    
+    def __init__(self, **options):
+        for name, value in get_option_defaults().items():
+            setattr(self, name, options.get(name, value))
+
+class ExportPS1(Operator, ExportHelper, PS1Exporter):
+    """Export to PlayStation 1 C header format"""
+    bl_idname = "export_scene.ps1"
+    bl_label = "Export PS1"
+    
+    filename_ext = ".h"
+    
+    filter_glob: StringProperty(
+        default="*.h",
+        options={'HIDDEN'},
+        maxlen=255,
+    )
+    
+    convert_coords: BoolProperty(
+        name="Convert to Z-up",
+        description="Convert Blender Y-up coordinates to PS1 Z-up (x, -z, y)",
+        default=True
+    )
+    
+    enable_unlit: BoolProperty(
+        name="Enable Unlit",
+        description="Export all polygons as unlit (disable lighting calculations)",
+        default=False
+    )
+    
+    enable_semi_transparency: BoolProperty(
+        name="Enable Semi-Transparency",
+        description="Enable semi-transparency for materials with alpha channels",
+        default=False
+    )
+    
+    enable_cutout_transparency: BoolProperty(
+        name="Enable Cutout Transparency",
+        description="Enable sharp cutout transparency using mask bit (bit 15) for textures with alpha",
+        default=False
+    )
+    
+    enable_specular: BoolProperty(
+        name="Enable Specular",
+        description="Export specular IOR values from Principled BSDF for specular highlights",
+        default=False
+    )
+    
+    enable_metallic: BoolProperty(
+        name="Enable Metallic",
+        description="Export metallic values from Principled BSDF for metallic materials",
+        default=False
+    )
+    
+    export_prim_templates: BoolProperty(
+        name="Export Primitive Templates",
+        description="Bake ready-made GPU primitives per face (PSyQ only) so the renderer only patches XY and lit colours each frame",
+        default=False
+    )
+    
+    grid_cell_size: FloatProperty(
+        name="Grid Cell Size",
+        description="Split the model into a uniform X/Z grid of this cell size (Blender units) with per-cell face ranges for frustum culling. 0 disables the grid",
+        default=0.0,
+        min=0.0
+    )
+    
+    export_portals: BoolProperty(
+        name="Export Portals/PVS",
+        description="Treat objects named portal* (or with a ps1_portal property) as portals between sub-meshes (rooms) and write a potentially visible set per room",
+        default=False
+    )
+    
+    export_collision: BoolProperty(
+        name="Export Collision Mesh",
+        description="Write a simplified collision mesh from objects named collision*/col_* (or with a ps1_collision property) and faces with a 'collision' material, falling back to the render meshes",
+        default=False
+    )
+    
+    export_scene_layout: BoolProperty(
+        name="Export Scene Layout",
+        description="Write a scene table of object instances (objects with a ps1_model property or collection instances) with transforms, texture slot and visibility mask",
+        default=False
+    )
+    
+    export_animations: BoolProperty(
+        name="Export Animations",
+        description="Export all actions as separate animation header files",
+        default=True
+    )
+    
+    rig_actions_only: BoolProperty(
+        name="Only Rig Actions",
+        description="Only bake actions that animate the exported meshes or their armatures (by assignment, NLA strips or animated bones/properties)",
+        default=True
+    )
+    
+    action_include: StringProperty(
+        name="Include Actions",
+        description="Comma-separated name patterns (e.g. walk*, idle) of actions to bake. Empty bakes every action",
+        default=""
+    )
+    
+    action_exclude: StringProperty(
+        name="Exclude Actions",
+        description="Comma-separated name patterns of actions never to bake",
+        default=""
+    )
+    
+    use_export_cache: BoolProperty(
+        name="Skip Unchanged Headers",
+        description="Keep a .ps1cache sidecar of input hashes and skip regenerating headers whose meshes, materials, actions and options are unchanged",
+        default=True
+    )
+    
+    write_stats_report: BoolProperty(
+        name="Write Stats Report",
+        description="Write blendname-stats.json with vertex, face and primitive counts, array sizes, animation sizes, texture VRAM and GPU packet bytes per frame",
+        default=True
+    )
+    
+    texture_depth: EnumProperty(
+        name="Texture Depth",
+        description="Colour depth the textures are converted to (TIM), for the VRAM figures in the stats report",
+        items=[
+            ('4', "4-bit", "16-colour CLUT"),
+            ('8', "8-bit", "256-colour CLUT"),
+            ('16', "16-bit", "Direct colour"),
+        ],
+        default='16'
+    )
+    
+    budget_ram_kb: IntProperty(
+        name="RAM Budget (KB)",
+        description="Fail the export when the arrays of all headers exceed this many KB. 0 disables the check",
+        default=0,
+        min=0
+    )
+    
+    budget_vram_kb: IntProperty(
+        name="VRAM Budget (KB)",
+        description="Fail the export when the model's textures need more than this many KB of VRAM. 0 disables the check",
+        default=0,
+        min=0
+    )
+    
+    budget_packet_kb: IntProperty(
+        name="GPU Packet Budget (KB)",
+        description="Fail the export when drawing every face needs more than this many KB of GPU packets per frame. 0 disables the check",
+        default=0,
+        min=0
+    )
+    
+    weld_vertices: EnumProperty(
+        name="Weld Vertices",
+        description="Merge vertices with the same fixed-point position, normal, colour and animation, and drop vertices no face uses",
+        items=[
+            ('NONE', "None", "Keep every mesh vertex"),
+            ('WITHIN_MESH', "Within Mesh", "Merge only vertices of the same sub-mesh"),
+            ('ACROSS_MESHES', "Across Meshes", "Also merge vertices shared between sub-meshes"),
+        ],
+        default='NONE'
+    )
+    
+    header_type: EnumProperty(
+        name="Header Type",
+        description="Choose the header file format",
+        items=[
+            ('PSYQ', "PSyQ (C)", "Export for PSyQ SDK (C) with libgte.h"),
+            ('PSYQO', "PSyQo (C++)", "Export for PSyQo SDK (C++) with stdint.h"),
+        ],
+        default='PSYQ'
+    )
+    
+    def draw(self, context):
+        layout = self.layout
+        layout.label(text="Export options:")
+        layout.prop(self, "convert_coords")
+        layout.prop(self, "enable_unlit")
+        layout.prop(self, "enable_semi_transparency")
+        layout.prop(self, "enable_cutout_transparency")
+        layout.prop(self, "enable_specular")
+        layout.prop(self, "enable_metallic")
+        layout.prop(self, "export_prim_templates")
+        layout.prop(self, "weld_vertices")
+        layout.prop(self, "export_scene_layout")
+        layout.prop(self, "grid_cell_size")
+        layout.prop(self, "export_portals")
+        layout.prop(self, "export_collision")
+        layout.prop(self, "export_animations")
+        if self.export_animations:
+            layout.prop(self, "rig_actions_only")
+            layout.prop(self, "action_include")
+            layout.prop(self, "action_exclude")
+        layout.prop(self, "use_export_cache")
+        layout.prop(self, "write_stats_report")
+        layout.prop(self, "texture_depth")
+        layout.prop(self, "budget_ram_kb")
+        layout.prop(self, "budget_vram_kb")
+        layout.prop(self, "budget_packet_kb")
+        layout.label(text="Header Type:")
+        layout.prop(self, "header_type", text="")
+    
+    def execute(self, context):
+        blend_filepath = bpy.data.filepath
+        if not blend_filepath:
+            show_message("Please save your .blend file first!", "Error", 'ERROR')
+            return {'CANCELLED'}
+        
+        base_name = os.path.splitext(os.path.basename(blend_filepath))[0]
+        export_dir = os.path.dirname(self.filepath)
+        
+        try:
+            notes = self.export_scene(export_dir, base_name)
+        except ExportError as e:
+            show_message(str(e), "Error", 'ERROR')
+            return {'CANCELLED'}
+        
+        for note in notes:
+            show_message(note, "Info", 'INFO')
+        show_message(f"Export complete! Files saved to {export_dir}", "Success", 'INFO')
+        return {'FINISHED'}
+
+def get_option_keywords():
+    """Keyword arguments of every export option's property, by option name"""
+    options = {}
+    for name, prop in ExportPS1.__annotations__.items():
+        if name != 'filter_glob':
+            options[name] = getattr(prop, 'keywords', prop if isinstance(prop, dict) else {})
+    return options
+
+def get_option_defaults():
+    """Export option names and defaults, taken from the operator's properties"""
+    return {name: keywords.get('default') for name, keywords in get_option_keywords().items()}
+
+def parse_cli_args(argv):
+    """Command line: every export option is a flag named after its property"""
+    parser = argparse.ArgumentParser(
+        prog="blender -b file.blend --python ps1_exporter.py --",
+        description="Export the open .blend to PlayStation 1 headers without the UI")
+    parser.add_argument("--out", required=True, help="Directory to write the headers to")
+    parser.add_argument("--name", help="Base name for the headers (default: the .blend file name)")
+    for name, keywords in get_option_keywords().items():
+        flag = "--" + name.replace('_', '-')
+        default = keywords.get('default')
+        if isinstance(default, bool):
+            parser.add_argument(flag, dest=name, action=argparse.BooleanOptionalAction, default=default)
+        elif isinstance(default, (int, float)):
+            parser.add_argument(flag, dest=name, type=type(default), default=default)
+        elif 'items' in keywords:
+            parser.add_argument(flag, dest=name, choices=[item[0] for item in keywords['items']], default=default)
+        else:
+            parser.add_argument(flag, dest=name, default=default)
+    return parser.parse_args(argv)
+
+def main_cli(argv):
+    """Headless entry point: blender -b file.blend --python ps1_exporter.py -- --out dir [options]"""
+    args = parse_cli_args(argv)
+    if not bpy.data.filepath and not args.name:
+        print("PS1 Exporter: no .blend loaded, pass one before --python or give --name")
+        return 1
+    
+    base_name = args.name or os.path.splitext(os.path.basename(bpy.data.filepath))[0]
+    options = {name: getattr(args, name) for name in get_option_defaults()}
+    os.makedirs(args.out, exist_ok=True)
+    
+    start = time.perf_counter()
+    try:
+        notes = HeadlessExporter(**options).export_scene(args.out, base_name)
+    except ExportError as e:
+        print(f"PS1 Exporter: {base_name}: {e}")
+        return 1
+    for note in notes:
+        print(f"PS1 Exporter: {base_name}: {note}")
+    print(f"PS1 Exporter: {base_name} exported to {args.out} in {time.perf_counter() - start:.2f}s")
+    return 0
 
 def menu_func_export(self, context):
     self.layout.operator(ExportPS1.bl_idname, text="PlayStation 1 (.h)")
@@ -864,4 +2397,7 @@ def unregister():
     bpy.types.TOPBAR_MT_file_export.remove(menu_func_export)
 
 if __name__ == "__main__":
+    # Arguments after "--" mean a command-line export; otherwise register the addon
+    if "--" in sys.argv:
+        sys.exit(main_cli(sys.argv[sys.argv.index("--") + 1:]))
     register()
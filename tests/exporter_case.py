@@ -0,0 +1,154 @@
+"""Run one exporter test case inside Blender.
+
+Usage:
+    blender -b [file.blend | --factory-startup] --python tests/exporter_case.py -- [--procedural SIZE] [--exporter path] --out dir --name case [exporter options]
+
+With --procedural the scene is replaced by generated meshes of the given grid
+size; otherwise the loaded .blend is exported as it is. --exporter exports
+with another ps1_exporter.py (e.g. an older revision) instead of the repo's.
+Prints one "PS1TEST {json}" line with the case's figures for
+run_exporter_tests.py.
+"""
+import argparse
+import importlib.util
+import json
+import math
+import os
+import sys
+import time
+
+import bpy
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import ps1_exporter
+
+def new_mesh_object(name, verts, faces, materials):
+    mesh = bpy.data.meshes.new(name)
+    mesh.from_pydata(verts, [], faces)
+    mesh.update()
+    for mat in materials:
+        mesh.materials.append(mat)
+    obj = bpy.data.objects.new(name, mesh)
+    bpy.context.scene.collection.objects.link(obj)
+    return obj
+
+def fill_face_data(mesh, coords):
+    """Planar UVs, corner colours from position, alternating smooth rows and materials"""
+    loop_vertex = np.empty(len(mesh.loops), dtype=np.int32)
+    mesh.loops.foreach_get("vertex_index", loop_vertex)
+    corner = coords[loop_vertex]
+    span = np.ptp(coords[:, :2], axis=0) + 1e-6
+    uv = (corner[:, :2] - coords[:, :2].min(axis=0)) / span
+    mesh.uv_layers.new(name="UVMap").data.foreach_set("uv", uv.astype(np.float32).ravel())
+
+    rgba = np.ones((len(corner), 4), dtype=np.float32)
+    rgba[:, :3] = 0.5 + 0.5 * np.sin(corner * 0.7)
+    mesh.color_attributes.new("Col", 'BYTE_COLOR', 'CORNER').data.foreach_set("color", rgba.ravel())
+
+    poly_index = np.arange(len(mesh.polygons))
+    mesh.polygons.foreach_set("use_smooth", (poly_index // 3) % 2 == 0)
+    mesh.polygons.foreach_set("material_index", (poly_index % len(mesh.materials)).astype(np.int32))
+
+# Half-width of the generated terrain in Blender units; PS1_SCALE_FACTOR 3072
+# puts 10 units at 30720, inside the 16-bit SVECTOR range
+PROCEDURAL_EXTENT = 10.0
+
+def build_procedural_scene(size):
+    """A size x size terrain grid (quads, with every fifth cell split into
+    triangles) and a small animated n-gon cap, deterministic for a given size
+    The grid always spans PROCEDURAL_EXTENT either side of the origin"""
+    for obj in list(bpy.data.objects):
+        bpy.data.objects.remove(obj)
+
+    image = bpy.data.images.new("procedural.png", 64, 64)
+    textured = bpy.data.materials.new("textured")
+    textured.use_nodes = True
+    textured.node_tree.nodes.new('ShaderNodeTexImage').image = image
+    plain = bpy.data.materials.new("plain")
+
+    step = 2 * PROCEDURAL_EXTENT / size
+    verts = []
+    for y in range(size + 1):
+        for x in range(size + 1):
+            verts.append((x * step - PROCEDURAL_EXTENT, y * step - PROCEDURAL_EXTENT,
+                          0.25 * math.sin(x * 0.5) * math.cos(y * 0.3)))
+    faces = []
+    for y in range(size):
+        for x in range(size):
+            a = y * (size + 1) + x
+            b, c, d = a + 1, a + size + 2, a + size + 1
+            if (x + y) % 5 == 0:
+                faces.extend([(a, b, c), (a, c, d)])
+            else:
+                faces.append((a, b, c, d))
+    terrain = new_mesh_object("terrain", verts, faces, [textured, plain])
+    fill_face_data(terrain.data, np.array(verts, dtype=np.float64))
+
+    # Octagon cap: one n-gon for the exporter to split, animated by its object transform
+    ring = [(math.cos(i * math.pi / 4), math.sin(i * math.pi / 4), 1.0) for i in range(8)]
+    cap = new_mesh_object("cap", ring, [tuple(range(8))], [plain])
+    fill_face_data(cap.data, np.array(ring, dtype=np.float64))
+    for frame in range(1, 9):
+        cap.location = (0.0, 0.0, 0.1 * frame)
+        cap.rotation_euler = (0.0, 0.0, frame * math.pi / 16)
+        cap.keyframe_insert("location", frame=frame)
+        cap.keyframe_insert("rotation_euler", frame=frame)
+    cap.animation_data.action.name = "bob"
+
+    scene = bpy.context.scene
+    scene.frame_start, scene.frame_end = 1, 8
+    scene.frame_set(1)
+
+def load_exporter(path):
+    """ps1_exporter.py from another path as its own module"""
+    spec = importlib.util.spec_from_file_location("ps1_exporter_under_test", path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+def export_with_operator(module, options, out_dir):
+    """Export with an exporter from before HeadlessExporter: the operator's
+    methods on a plain object, given the options it has. Those exporters name
+    the files after the .blend, so only cases named after theirs match"""
+    methods = {name: value for name, value in vars(module.ExportPS1).items() if callable(value)}
+    exporter = type("OperatorExporter", (), methods)()
+    known = getattr(module.ExportPS1, '__annotations__', {})
+    for name, value in options.items():
+        if name in known:
+            setattr(exporter, name, value)
+    exporter.filepath = os.path.join(out_dir, "export.h")
+    module.show_message = lambda *args, **kwargs: None  # No popups in background mode
+    if exporter.export_ps1(bpy.context) != {'FINISHED'}:
+        raise RuntimeError("the exporter cancelled the export")
+
+def main(argv):
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--procedural", type=int, default=0)
+    parser.add_argument("--exporter")
+    case_args, exporter_argv = parser.parse_known_args(argv)
+    args = ps1_exporter.parse_cli_args(exporter_argv)
+    exporter = load_exporter(case_args.exporter) if case_args.exporter else ps1_exporter
+
+    if case_args.procedural:
+        build_procedural_scene(case_args.procedural)
+
+    options = {name: getattr(args, name) for name in ps1_exporter.get_option_defaults()}
+    os.makedirs(args.out, exist_ok=True)
+
+    start = time.perf_counter()
+    try:
+        if hasattr(exporter, "HeadlessExporter"):
+            exporter.HeadlessExporter(**options).export_scene(args.out, args.name)
+        else:
+            export_with_operator(exporter, options, args.out)
+    except (getattr(exporter, "ExportError", RuntimeError), RuntimeError) as e:
+        print(f"PS1TEST error: {e}")
+        return 1
+    seconds = time.perf_counter() - start
+
+    print("PS1TEST " + json.dumps({'export_seconds': seconds}))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []))
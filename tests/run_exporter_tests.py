@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Golden-output regression and throughput tests for ps1_exporter.py.
+
+Usage:
+    python tests/run_exporter_tests.py [--blender path] [-k pattern] [--update-golden] [--results timings.json]
+                                       [--exporter path] [--golden-files-only]
+
+Every case exports in its own background Blender (blender -b) and the output
+is compared byte for byte with tests/golden/<case>/. Export time (measured
+inside Blender), wall time and the Blender process's peak memory are reported
+per case, so the procedural cases give a scaling curve. The exit code is
+non-zero if any case fails.
+
+--exporter runs another ps1_exporter.py, so golden files can be recorded with
+an older revision; --golden-files-only then checks the current exporter
+against just the files that revision wrote.
+"""
+import argparse
+import difflib
+import fnmatch
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+TESTS_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.normpath(os.path.join(TESTS_DIR, ".."))
+GOLDEN_DIR = os.path.join(TESTS_DIR, "golden")
+CASE_SCRIPT = os.path.join(TESTS_DIR, "exporter_case.py")
+RIKA = os.path.join(REPO_DIR, "examples", "3Dmodel", "rika.blend")
+
+# (name, .blend to open or None for generated meshes, grid size, exporter options)
+CASES = [
+    ("procedural_8", None, 8, []),
+    ("procedural_32", None, 32, []),
+    ("procedural_128", None, 128, []),
+    ("procedural_256", None, 256, ["--export-prim-templates"]),
+    ("procedural_grid", None, 64, ["--grid-cell-size", "2.5", "--export-collision", "--enable-specular", "--enable-metallic"]),
+    ("procedural_weld", None, 64, ["--weld-vertices", "ACROSS_MESHES"]),
+    ("rika", RIKA, 0, []),
+    ("rika_weld", RIKA, 0, ["--weld-vertices", "WITHIN_MESH"]),
+    ("rika_templates", RIKA, 0, ["--export-prim-templates", "--enable-unlit"]),
+    ("rika_psyqo", RIKA, 0, ["--header-type", "PSYQO", "--no-convert-coords"]),
+]
+
+def run_case(blender, name, blend_file, size, options, out_dir, exporter=None):
+    """Export one case; returns (return code, output, export seconds, wall seconds, peak RSS in bytes)"""
+    command = [blender, "-b"] + ([blend_file] if blend_file else ["--factory-startup"])
+    command += ["--python-exit-code", "1", "--python", CASE_SCRIPT, "--"]
+    if size:
+        command += ["--procedural", str(size)]
+    if exporter:
+        command += ["--exporter", os.path.abspath(exporter)]
+    command += ["--out", out_dir, "--name", name, "--no-use-export-cache"] + options
+
+    start = time.perf_counter()
+    proc = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    output = proc.stdout.read()
+    proc.stdout.close()
+    # wait4 gives this child's own peak RSS (KB on Linux, bytes on macOS)
+    _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    wall = time.perf_counter() - start
+    peak = usage.ru_maxrss * (1 if sys.platform == "darwin" else 1024)
+
+    export_seconds = None
+    for line in output.splitlines():
+        if line.startswith("PS1TEST {"):
+            export_seconds = json.loads(line[len("PS1TEST "):])['export_seconds']
+    return proc.returncode, output, export_seconds, wall, peak
+
+def list_outputs(directory):
+    """Exported files, without the cache sidecar and other dotfiles"""
+    if not os.path.isdir(directory):
+        return []
+    return sorted(n for n in os.listdir(directory) if not n.startswith("."))
+
+def compare_with_golden(name, out_dir, golden_files_only=False):
+    """Problems found comparing the case's output with its golden files
+    golden_files_only ignores exported files the golden output does not have"""
+    golden = os.path.join(GOLDEN_DIR, name)
+    if not os.path.isdir(golden):
+        return [f"no golden output in {os.path.relpath(golden, REPO_DIR)}; "
+                f"check the export and record it with --update-golden -k {name}"]
+
+    problems = []
+    expected, actual = list_outputs(golden), list_outputs(out_dir)
+    for missing in sorted(set(expected) - set(actual)):
+        problems.append(f"{missing} was not exported")
+    for extra in sorted(set(actual) - set(expected)):
+        if not golden_files_only:
+            problems.append(f"{extra} is not in the golden output")
+    for filename in sorted(set(expected) & set(actual)):
+        with open(os.path.join(golden, filename), encoding="utf-8") as f:
+            want = f.readlines()
+        with open(os.path.join(out_dir, filename), encoding="utf-8") as f:
+            got = f.readlines()
+        if want != got:
+            diff = list(difflib.unified_diff(want, got, f"golden/{filename}", f"output/{filename}", n=1))
+            problems.append(f"{filename} differs:\n" + "".join(diff[:24]).rstrip())
+    return problems
+
+def update_golden(name, out_dir):
+    golden = os.path.join(GOLDEN_DIR, name)
+    shutil.rmtree(golden, ignore_errors=True)
+    os.makedirs(golden)
+    for filename in list_outputs(out_dir):
+        shutil.copyfile(os.path.join(out_dir, filename), os.path.join(golden, filename))
+
+def main():
+    parser = argparse.ArgumentParser(description="Golden-output and throughput tests for the PS1 exporter")
+    parser.add_argument("--blender", default=os.environ.get("BLENDER", "blender"), help="Blender executable (default: $BLENDER or blender)")
+    parser.add_argument("-k", dest="pattern", default="*", help="Only run cases whose name matches this pattern")
+    parser.add_argument("--update-golden", action="store_true", help="Replace the golden output with this run's output")
+    parser.add_argument("--results", help="Write the per-case timings and peak memory to this JSON file")
+    parser.add_argument("--exporter", help="Export with this ps1_exporter.py instead of the repo's (e.g. an older revision)")
+    parser.add_argument("--golden-files-only", action="store_true",
+                        help="Only compare the files in the golden output, ignoring newer outputs")
+    args = parser.parse_args()
+
+    cases = [case for case in CASES if fnmatch.fnmatch(case[0], args.pattern)]
+    if not cases:
+        print(f"No case matches {args.pattern}")
+        return 1
+
+    failures = []
+    results = []
+    with tempfile.TemporaryDirectory(prefix="ps1_exporter_tests_") as work:
+        for name, blend_file, size, options in cases:
+            out_dir = os.path.join(work, name)
+            code, output, export_seconds, wall, peak = run_case(args.blender, name, blend_file, size, options, out_dir, args.exporter)
+
+            if code != 0 or export_seconds is None:
+                problems = [f"export failed (exit code {code}):\n    " + output.strip().replace("\n", "\n    ")]
+            elif args.update_golden:
+                update_golden(name, out_dir)
+                problems = []
+            else:
+                problems = compare_with_golden(name, out_dir, args.golden_files_only)
+
+            faces = None
+            stats_path = os.path.join(out_dir, f"{name}-stats.json")
+            if os.path.exists(stats_path):
+                with open(stats_path, encoding="utf-8") as f:
+                    faces = json.load(f).get('geometry', {}).get('faces')
+
+            status = "FAIL" if problems else ("new " if args.update_golden else "ok  ")
+            timing = f"{export_seconds:7.3f}s export" if export_seconds is not None else "      - export"
+            print(f"{status} {name:<18} {faces if faces is not None else '-':>7} faces  {timing}  "
+                  f"{wall:6.2f}s wall  {peak / (1 << 20):7.1f} MB peak")
+            for problem in problems:
+                print("    " + problem.replace("\n", "\n    "))
+            if problems:
+                failures.append(name)
+            results.append({'case': name, 'faces': faces, 'export_seconds': export_seconds,
+                            'wall_seconds': wall, 'peak_rss_bytes': peak, 'passed': not problems})
+
+    if args.results:
+        with open(args.results, "w", encoding="utf-8") as f:
+            json.dump(results, f, indent=2)
+
+    print(f"\n{len(cases)} case(s), {len(failures)} failed")
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
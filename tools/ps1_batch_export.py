@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Export many .blend files to PlayStation 1 headers in parallel Blender processes.
+
+Usage:
+    python ps1_batch_export.py --out build/headers assets/ [more.blend ...] -- [exporter options]
+
+Directories are searched recursively for .blend files. Everything after "--"
+is passed to ps1_exporter.py unchanged (e.g. --export-collision --no-export-animations).
+Each file gets its own headless Blender (blender -b); per-file timings are
+reported as they finish and the exit code is non-zero if any export failed.
+Files that would write the same headers (the same base name in one output
+directory) are rejected before anything runs; use --per-file-dirs for trees
+that reuse names.
+"""
+import argparse
+import os
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+EXPORTER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ps1_exporter.py")
+
+def find_blend_files(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files.extend(os.path.join(root, n) for n in sorted(names) if n.endswith(".blend"))
+        else:
+            files.append(path)
+    return files
+
+def get_output_dir(args, blend_file):
+    if args.per_file_dirs:
+        return os.path.join(args.out, os.path.splitext(os.path.basename(blend_file))[0])
+    return args.out
+
+def get_base_name(blend_file, exporter_args):
+    """Header base name the exporter will use: --name if given, else the .blend's name"""
+    for i, arg in enumerate(exporter_args):
+        if arg == "--name" and i + 1 < len(exporter_args):
+            return exporter_args[i + 1]
+        if arg.startswith("--name="):
+            return arg[len("--name="):]
+    return os.path.splitext(os.path.basename(blend_file))[0]
+
+def find_clashes(args, files, exporter_args):
+    """Groups of files that would write the same headers and export cache"""
+    targets = {}
+    for blend_file in files:
+        key = (os.path.normcase(os.path.abspath(get_output_dir(args, blend_file))), get_base_name(blend_file, exporter_args))
+        targets.setdefault(key, []).append(blend_file)
+    return [group for group in targets.values() if len(group) > 1]
+
+def export_file(blender, blend_file, out_dir, exporter_args):
+    """Run one headless export; returns (file, seconds, return code, output)"""
+    command = [blender, "-b", blend_file, "--python-exit-code", "1",
+               "--python", os.path.normpath(EXPORTER), "--", "--out", out_dir] + exporter_args
+    start = time.perf_counter()
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    return blend_file, time.perf_counter() - start, result.returncode, result.stdout
+
+def main():
+    argv = sys.argv[1:]
+    exporter_args = []
+    if "--" in argv:
+        exporter_args = argv[argv.index("--") + 1:]
+        argv = argv[:argv.index("--")]
+
+    parser = argparse.ArgumentParser(description="Export .blend files to PS1 headers in parallel")
+    parser.add_argument("paths", nargs="+", help=".blend files or directories to search")
+    parser.add_argument("--out", required=True, help="Directory to write the headers to")
+    parser.add_argument("--per-file-dirs", action="store_true", help="Write each file's headers to <out>/<blend name>/")
+    parser.add_argument("--blender", default=os.environ.get("BLENDER", "blender"), help="Blender executable (default: $BLENDER or blender)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1, help="Parallel Blender processes (default: CPU count)")
+    parser.add_argument("-v", "--verbose", action="store_true", help="Print each export's full output")
+    args = parser.parse_args(argv)
+
+    files = find_blend_files(args.paths)
+    if not files:
+        print("No .blend files found")
+        return 1
+
+    # Parallel exports of one base name into one directory would overwrite each other
+    clashes = find_clashes(args, files, exporter_args)
+    if clashes:
+        for group in clashes:
+            print("Same headers written by: " + ", ".join(group))
+        print("Rename the files, or use --per-file-dirs (and no --name) to give each its own directory")
+        return 1
+
+    start = time.perf_counter()
+    failures = []
+    timings = []
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        jobs = []
+        for blend_file in files:
+            jobs.append(pool.submit(export_file, args.blender, blend_file, get_output_dir(args, blend_file), exporter_args))
+
+        for job in as_completed(jobs):
+            blend_file, seconds, code, output = job.result()
+            timings.append((seconds, blend_file))
+            print(f"{'ok  ' if code == 0 else 'FAIL'} {seconds:7.2f}s  {blend_file}")
+            if code != 0:
+                failures.append(blend_file)
+            if args.verbose or code != 0:
+                print("    " + output.strip().replace("\n", "\n    "))
+
+    total = time.perf_counter() - start
+    busy = sum(seconds for seconds, _ in timings)
+    print(f"\n{len(files)} file(s), {len(failures)} failed, {total:.2f}s wall, {busy:.2f}s summed over {args.jobs} job(s)")
+    for seconds, blend_file in sorted(timings, reverse=True)[:5]:
+        print(f"  slowest: {seconds:7.2f}s  {blend_file}")
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())